@@ -1,29 +1,97 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <ctime>
 #include <coroutine>
 #include <cstring>
+#include <deque>
+#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <random>
+#include <semaphore>
+#include <type_traits>
 #include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
-#include <sys/event.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/utsname.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#define BENCH_HAVE_KQUEUE 1
+#include <sys/event.h>
+#endif
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+#if defined(__linux__)
+#define BENCH_HAVE_EPOLL 1
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#define BENCH_HAVE_PERF 1
+#include <linux/perf_event.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define BENCH_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_X86_SIMD 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__aarch64__)) && (defined(__linux__) || defined(__APPLE__))
+#define BENCH_HAVE_FIBER_ASM 1
+#endif
+
+#if defined(__linux__) && __has_include(<ucontext.h>)
+#define BENCH_HAVE_UCONTEXT 1
+#include <ucontext.h>
+#endif
+
+#if !defined(BENCH_HAVE_KQUEUE) && !defined(BENCH_HAVE_EPOLL)
+#error "bench.cpp needs kqueue or epoll"
+#endif
+
 using steady_clock = std::chrono::steady_clock;
 
 static double seconds_now() {
@@ -39,14 +107,90 @@ static std::string fmt_sec(double s) {
 struct Config {
     int tasks = 2000;
     int concurrency = 200;
-    int repeats = 5;
-    int warmup = 1;
+    int repeats = 5;         // with target_ci: the minimum number of timed runs
+    int warmup = 1;          // -1: --warmup auto
+    double target_ci = 0;    // > 0: repeat until the median's 95% CI is within this many percent
+    int max_repeats = 100;
+    double time_budget_s = 0; // > 0: stop repeating a model after this many seconds of timed runs
     int cpu_units = 200000;
     int payload_size = 256;
     int backlog = 4096;
     int timeout_ms = 20000;
+    int requests_per_conn = 1;
+    int pipeline_depth = 1;
+    int rate = 0;            // > 0 adds open-loop rows: task arrivals per second
+    std::string arrival = "poisson";
+#if defined(BENCH_HAVE_EPOLL)
+    std::string loop = "epoll";
+#else
+    std::string loop = "kqueue";
+#endif
+    std::string server = "threads";
+    std::string arm = "batched";
+    std::string transport = "tcp";
+    bool nodelay = false;
+    std::string echo = "copy"; // how the echo server moves bytes: copy or splice
+    int echo_buf_kb = 4;
+    int stream_mb = 0;       // > 0 adds streaming rows: MiB echoed per run
+    int stream_conns = 4;
+    int stream_chunk_kb = 256;
+#if defined(BENCH_HAVE_FIBER_ASM)
+    std::string fiber_switch = "asm";
+#else
+    std::string fiber_switch = "ucontext";
+#endif
+    int fiber_stack_kb = 64;
+    int server_threads = 0;
+    int server_cpu_units = 0; // > 0: the echo server runs cpu_work(N) per message
+    std::string server_compute = "inline"; // where: inline, pool or coroutines
+    int compute_threads = 0;
+    bool server_only = false; // run just the echo server, until SIGINT/SIGTERM
+    bool client = false;      // drive a remote --target instead of a local server
+    bool coordinator = false; // barrier and merge for --clients joined clients
+    std::string bind;         // ADDR[:PORT] the server or coordinator listens on
+    std::string target;       // HOST:PORT of a --server-only
+    std::string join;         // HOST:PORT of a --coordinator
+    int clients = 1;
+    int workers = 0;
+    int spawn_tasks = 500;
+    int spawn_heap_mb = 256;
+    std::string spawn_exec = "/usr/bin/true";
+    std::string kernel = "scalar";
+    int grain = 1;
+    int quantum_us = 0;      // > 0: CPU coroutines yield after this long instead of every 5000 units
+    int timers = 0;          // > 0 runs the timer wheel benchmark
+    int timer_span_ms = 1000;
+    int mem_budget_mb = 0;   // > 0 runs the concurrency-vs-memory sweep
+    int sweep_max = 65536;
+    std::string pin;         // "", compact, scatter or a CPU list
+    std::string server_cpus; // CPU list for the echo server's threads
+    std::string numa = "none";
+    std::vector<int> client_cpus; // resolved from pin: worker i runs on [i % size]
+    std::vector<int> server_cpu_set;
+    std::vector<std::pair<std::string, std::vector<int>>> sweep; // --sweep dim=v1,v2 ...
+    std::string baseline = "threads";
+    std::string json;        // --json FILE
+    std::string csv;         // --csv FILE
+    std::string compare;     // --compare FILE, an earlier --json
+    double regress_pct = 5;
+    std::vector<std::string> models; // --models a,b,suite:c; empty: all
+    std::vector<std::string> suites; // --suite cpu,io; empty: all
+    bool list_models = false;
 };
 
+// Config fields --sweep can vary, by their option names.
+static int* sweep_field(Config& cfg, const std::string& name) {
+    if (name == "concurrency") return &cfg.concurrency;
+    if (name == "tasks") return &cfg.tasks;
+    if (name == "cpu-units") return &cfg.cpu_units;
+    if (name == "payload-size") return &cfg.payload_size;
+    if (name == "requests-per-conn") return &cfg.requests_per_conn;
+    if (name == "pipeline-depth") return &cfg.pipeline_depth;
+    if (name == "grain") return &cfg.grain;
+    if (name == "workers") return &cfg.workers;
+    return nullptr;
+}
+
 static int to_int(const char* s, int def) {
     if (!s) return def;
     char* end = nullptr;
@@ -55,6 +199,188 @@ static int to_int(const char* s, int def) {
     return (int)v;
 }
 
+// "a,b,,c" -> {a, b, c}
+static std::vector<std::string> split_list(const std::string& s) {
+    std::vector<std::string> out;
+    std::istringstream in(s);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}; empty if the list is malformed.
+static std::vector<int> parse_cpu_list(const std::string& s) {
+    std::vector<int> out;
+    std::istringstream in(s);
+    std::string part;
+    while (std::getline(in, part, ',')) {
+        while (!part.empty() && std::isspace((unsigned char)part.back())) part.pop_back();
+        if (part.empty()) continue;
+        char* end = nullptr;
+        long lo = std::strtol(part.c_str(), &end, 10);
+        if (end == part.c_str()) return {};
+        long hi = lo;
+        if (*end == '-') {
+            const char* p = end + 1;
+            hi = std::strtol(p, &end, 10);
+            if (end == p) return {};
+        }
+        if (*end != '\0' || lo < 0 || hi < lo) return {};
+        for (long c = lo; c <= hi; c++) out.push_back((int)c);
+    }
+    return out;
+}
+
+#if defined(__linux__)
+static std::vector<int> allowed_cpus() {
+    std::vector<int> out;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &set)) out.push_back(c);
+        }
+    }
+    return out;
+}
+
+// NUMA node of every CPU from sysfs; node 0 for CPUs sysfs does not list.
+static std::vector<int> cpu_nodes() {
+    constexpr int kMaxNodes = 64;
+    std::vector<int> node_of(CPU_SETSIZE, 0);
+    for (int n = 0; n < kMaxNodes; n++) {
+        std::ifstream f("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+        std::string line;
+        if (!f || !std::getline(f, line)) continue;
+        for (int c : parse_cpu_list(line)) {
+            if (c < CPU_SETSIZE) node_of[(size_t)c] = n;
+        }
+    }
+    return node_of;
+}
+
+// compact fills one NUMA node in CPU-id order before moving to the next;
+// scatter deals CPUs round-robin across nodes. CPUs reserved for the server
+// are left out unless that would leave the clients nothing.
+static std::vector<int> placement_order(const std::string& mode, const std::vector<int>& exclude) {
+    std::vector<int> cpus;
+    for (int c : allowed_cpus()) {
+        if (std::find(exclude.begin(), exclude.end(), c) == exclude.end()) cpus.push_back(c);
+    }
+    if (cpus.empty()) cpus = allowed_cpus();
+
+    std::vector<int> node_of = cpu_nodes();
+    std::vector<std::vector<int>> by_node;
+    for (int c : cpus) {
+        size_t n = (size_t)node_of[(size_t)c];
+        if (by_node.size() <= n) by_node.resize(n + 1);
+        by_node[n].push_back(c);
+    }
+
+    std::vector<int> out;
+    if (mode == "compact") {
+        for (const auto& node : by_node) out.insert(out.end(), node.begin(), node.end());
+        return out;
+    }
+    for (size_t k = 0; out.size() < cpus.size(); k++) {
+        for (const auto& node : by_node) {
+            if (k < node.size()) out.push_back(node[k]);
+        }
+    }
+    return out;
+}
+
+// Restricts the calling thread to `cpus`; with --numa local its future
+// allocations are also bound to the nodes those CPUs belong to.
+static void pin_thread(const std::vector<int>& cpus, bool numa_local) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    if (::sched_setaffinity(0, sizeof(set), &set) < 0) std::perror("sched_setaffinity");
+    if (!numa_local) return;
+
+    static const std::vector<int> node_of = cpu_nodes();
+    unsigned long mask = 0;
+    for (int c : cpus) {
+        if (c < CPU_SETSIZE) mask |= 1ul << node_of[(size_t)c];
+    }
+    if (::syscall(SYS_set_mempolicy, MPOL_BIND, &mask, sizeof(mask) * 8) < 0) std::perror("set_mempolicy");
+}
+#endif
+
+// Resolves --pin / --server-cpus into explicit CPU lists once, so workers
+// only index into a vector when they start.
+static void resolve_placement(Config& cfg) {
+    if (cfg.pin.empty() && cfg.server_cpus.empty()) return;
+#if defined(__linux__)
+    if (!cfg.server_cpus.empty()) {
+        cfg.server_cpu_set = parse_cpu_list(cfg.server_cpus);
+        if (cfg.server_cpu_set.empty()) {
+            std::cerr << "Bad --server-cpus list '" << cfg.server_cpus << "'\n";
+            std::exit(1);
+        }
+    }
+    if (cfg.pin.empty()) return;
+    if (cfg.pin == "compact" || cfg.pin == "scatter") {
+        cfg.client_cpus = placement_order(cfg.pin, cfg.server_cpu_set);
+    } else {
+        cfg.client_cpus = parse_cpu_list(cfg.pin);
+    }
+    if (cfg.client_cpus.empty()) {
+        std::cerr << "Bad --pin value '" << cfg.pin << "'\n";
+        std::exit(1);
+    }
+#else
+    std::cerr << "CPU pinning needs Linux; ignoring --pin and --server-cpus\n";
+#endif
+}
+
+// Pins benchmark worker `index` (thread, pool worker or child process) to its
+// --pin CPU. No-op without --pin.
+static void pin_client(const Config& cfg, int index) {
+#if defined(__linux__)
+    if (cfg.client_cpus.empty()) return;
+    pin_thread({cfg.client_cpus[(size_t)index % cfg.client_cpus.size()]}, cfg.numa == "local");
+#else
+    (void)cfg;
+    (void)index;
+#endif
+}
+
+// Pins a single-threaded model's driver (the main thread) to worker 0's CPU
+// for the duration of one run, then restores the previous mask and policy.
+class ScopedPin {
+public:
+    explicit ScopedPin(const Config& cfg) {
+#if defined(__linux__)
+        if (cfg.client_cpus.empty()) return;
+        active_ = ::sched_getaffinity(0, sizeof(saved_), &saved_) == 0;
+        if (active_) pin_client(cfg, 0);
+#else
+        (void)cfg;
+#endif
+    }
+    ~ScopedPin() {
+#if defined(__linux__)
+        if (!active_) return;
+        (void)::sched_setaffinity(0, sizeof(saved_), &saved_);
+        (void)::syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+#endif
+    }
+    ScopedPin(const ScopedPin&) = delete;
+    ScopedPin& operator=(const ScopedPin&) = delete;
+
+private:
+#if defined(__linux__)
+    cpu_set_t saved_;
+    bool active_ = false;
+#endif
+};
+
 static Config parse_args(int argc, char** argv) {
     Config cfg;
     for (int i = 1; i < argc; i++) {
@@ -63,26 +389,163 @@ static Config parse_args(int argc, char** argv) {
             if (i + 1 >= argc) return def;
             return to_int(argv[++i], def);
         };
+        auto next_str = [&](const std::string& def) {
+            if (i + 1 >= argc) return def;
+            return std::string(argv[++i]);
+        };
 
         if (a == "--tasks") cfg.tasks = next(cfg.tasks);
         else if (a == "--concurrency") cfg.concurrency = next(cfg.concurrency);
         else if (a == "--repeats") cfg.repeats = next(cfg.repeats);
-        else if (a == "--warmup") cfg.warmup = next(cfg.warmup);
+        else if (a == "--warmup") {
+            std::string w = next_str("");
+            cfg.warmup = w == "auto" ? -1 : to_int(w.c_str(), cfg.warmup);
+        }
+        else if (a == "--target-ci") cfg.target_ci = std::atof(next_str("0").c_str());
+        else if (a == "--max-repeats") cfg.max_repeats = next(cfg.max_repeats);
+        else if (a == "--time-budget-s") cfg.time_budget_s = std::atof(next_str("0").c_str());
         else if (a == "--cpu-units") cfg.cpu_units = next(cfg.cpu_units);
         else if (a == "--payload-size") cfg.payload_size = next(cfg.payload_size);
         else if (a == "--backlog") cfg.backlog = next(cfg.backlog);
         else if (a == "--timeout-ms") cfg.timeout_ms = next(cfg.timeout_ms);
+        else if (a == "--requests-per-conn") cfg.requests_per_conn = next(cfg.requests_per_conn);
+        else if (a == "--pipeline-depth") cfg.pipeline_depth = next(cfg.pipeline_depth);
+        else if (a == "--rate") cfg.rate = next(cfg.rate);
+        else if (a == "--arrival") cfg.arrival = next_str(cfg.arrival);
+        else if (a == "--loop") cfg.loop = next_str(cfg.loop);
+        else if (a == "--server") cfg.server = next_str(cfg.server);
+        else if (a == "--arm") cfg.arm = next_str(cfg.arm);
+        else if (a == "--server-threads") cfg.server_threads = next(cfg.server_threads);
+        else if (a == "--server-cpu-units") cfg.server_cpu_units = next(cfg.server_cpu_units);
+        else if (a == "--server-compute") cfg.server_compute = next_str(cfg.server_compute);
+        else if (a == "--compute-threads") cfg.compute_threads = next(cfg.compute_threads);
+        else if (a == "--server-only") cfg.server_only = true;
+        else if (a == "--client") cfg.client = true;
+        else if (a == "--coordinator") cfg.coordinator = true;
+        else if (a == "--bind") cfg.bind = next_str(cfg.bind);
+        else if (a == "--target") cfg.target = next_str(cfg.target);
+        else if (a == "--join") cfg.join = next_str(cfg.join);
+        else if (a == "--clients") cfg.clients = next(cfg.clients);
+        else if (a == "--workers") cfg.workers = next(cfg.workers);
+        else if (a == "--spawn-tasks") cfg.spawn_tasks = next(cfg.spawn_tasks);
+        else if (a == "--spawn-heap-mb") cfg.spawn_heap_mb = next(cfg.spawn_heap_mb);
+        else if (a == "--spawn-exec") cfg.spawn_exec = next_str(cfg.spawn_exec);
+        else if (a == "--kernel") cfg.kernel = next_str(cfg.kernel);
+        else if (a == "--grain") cfg.grain = next(cfg.grain);
+        else if (a == "--quantum-us") cfg.quantum_us = next(cfg.quantum_us);
+        else if (a == "--baseline") cfg.baseline = next_str(cfg.baseline);
+        else if (a == "--models") cfg.models = split_list(next_str(""));
+        else if (a == "--suite") cfg.suites = split_list(next_str(""));
+        else if (a == "--list-models") cfg.list_models = true;
+        else if (a == "--transport") cfg.transport = next_str(cfg.transport);
+        else if (a == "--nodelay") cfg.nodelay = true;
+        else if (a == "--echo") cfg.echo = next_str(cfg.echo);
+        else if (a == "--echo-buf-kb") cfg.echo_buf_kb = next(cfg.echo_buf_kb);
+        else if (a == "--stream-mb") cfg.stream_mb = next(cfg.stream_mb);
+        else if (a == "--stream-conns") cfg.stream_conns = next(cfg.stream_conns);
+        else if (a == "--stream-chunk-kb") cfg.stream_chunk_kb = next(cfg.stream_chunk_kb);
+        else if (a == "--fiber-switch") cfg.fiber_switch = next_str(cfg.fiber_switch);
+        else if (a == "--fiber-stack-kb") cfg.fiber_stack_kb = next(cfg.fiber_stack_kb);
+        else if (a == "--json") cfg.json = next_str(cfg.json);
+        else if (a == "--csv") cfg.csv = next_str(cfg.csv);
+        else if (a == "--compare") cfg.compare = next_str(cfg.compare);
+        else if (a == "--regress-pct") cfg.regress_pct = std::atof(next_str("5").c_str());
+        else if (a == "--sweep") {
+            // Takes every following dim=v1,v2,... argument.
+            while (i + 1 < argc && argv[i + 1][0] != '-' && std::strchr(argv[i + 1], '=')) {
+                std::string spec = argv[++i];
+                std::string name = spec.substr(0, spec.find('='));
+                std::vector<int> values;
+                std::istringstream in(spec.substr(spec.find('=') + 1));
+                std::string v;
+                while (std::getline(in, v, ',')) {
+                    if (!v.empty()) values.push_back(to_int(v.c_str(), INT_MIN));
+                }
+                Config probe;
+                bool bad = !sweep_field(probe, name) || values.empty();
+                for (int x : values) bad |= x < 1;
+                if (bad) {
+                    std::cerr << "Bad --sweep dimension '" << spec << "'\n";
+                    std::exit(1);
+                }
+                cfg.sweep.emplace_back(name, values);
+            }
+        }
+        else if (a == "--pin") cfg.pin = next_str(cfg.pin);
+        else if (a == "--server-cpus") cfg.server_cpus = next_str(cfg.server_cpus);
+        else if (a == "--numa") cfg.numa = next_str(cfg.numa);
+        else if (a == "--timers") cfg.timers = next(cfg.timers);
+        else if (a == "--timer-span-ms") cfg.timer_span_ms = next(cfg.timer_span_ms);
+        else if (a == "--mem-budget-mb") cfg.mem_budget_mb = next(cfg.mem_budget_mb);
+        else if (a == "--sweep-max") cfg.sweep_max = next(cfg.sweep_max);
         else if (a == "--help" || a == "-h") {
             std::cout <<
                 "Usage: ./bench [options]\n"
                 "  --tasks N\n"
                 "  --concurrency N\n"
                 "  --repeats N\n"
-                "  --warmup N\n"
+                "  --warmup N|auto      (auto: until three untimed runs agree within 10%)\n"
+                "  --target-ci PCT      (repeat until the median's 95% CI is within PCT percent;\n"
+                "                        --repeats becomes the minimum)\n"
+                "  --max-repeats N      (cap for --target-ci, default 100)\n"
+                "  --time-budget-s S    (stop repeating a model after S seconds of timed runs)\n"
                 "  --cpu-units N\n"
+                "  --kernel scalar|simd (one LCG chain, or 16 independent lanes per task)\n"
+                "  --grain N            (tasks claimed per fetch_add in CPU threads)\n"
+                "  --quantum-us N       (CPU coroutines yield after N us of work, read off the cycle\n"
+                "                        counter; default: every 5000 units)\n"
+                "  --sweep DIM=V1,V2 ... (run the cartesian product in one process; DIM is concurrency,\n"
+                "                        tasks, cpu-units, payload-size, requests-per-conn, pipeline-depth,\n"
+                "                        grain or workers)\n"
+                "  --baseline MODEL     (model that --sweep speedups are relative to, default threads)\n"
+                "  --transport tcp|tcp6|unix|socketpair (client to echo server; default tcp)\n"
+                "  --nodelay            (TCP_NODELAY on client and server sockets)\n"
+                "  --echo copy|splice   (server echoes through a user buffer, or socket->pipe->socket; splice on Linux only)\n"
+                "  --echo-buf-kb N      (server buffer or pipe size per connection, default 4)\n"
+                "  --stream-mb N        (also run streaming rows: N MiB echoed per run)\n"
+                "  --stream-conns N     (connections the streaming rows split that over, default 4)\n"
+                "  --stream-chunk-kb N  (streaming send/receive size, default 256)\n"
+                "  --fiber-switch asm|ucontext (stackful fiber context switch; ucontext on Linux only)\n"
+                "  --fiber-stack-kb N   (fiber stack size, plus one guard page; default 64)\n"
+                "  --suite LIST         (cpu,io,open_loop,stream,spawn; default all)\n"
+                "  --models LIST        (model names, or suite:name, e.g. coroutines,io:io_uring)\n"
+                "  --list-models\n"
+                "  --json FILE          (write config, host, raw runs, latency, counters and memory)\n"
+                "  --csv FILE           (one row per raw run)\n"
+                "  --compare FILE       (flag models slower than an earlier --json; exit status 2 on regression)\n"
+                "  --regress-pct P      (minimum slowdown --compare reports, default 5)\n"
                 "  --payload-size N\n"
                 "  --backlog N\n"
-                "  --timeout-ms N\n";
+                "  --timeout-ms N\n"
+                "  --requests-per-conn N (echo round-trips per connection)\n"
+                "  --pipeline-depth D   (requests kept outstanding per connection)\n"
+                "  --rate R             (also run open-loop I/O rows: R task arrivals per second)\n"
+                "  --arrival poisson|uniform (arrival process for --rate)\n"
+                "  --loop kqueue|epoll\n"
+                "  --arm batched|syscall (changelist/persistent epoll registration, or one syscall per arm)\n"
+                "  --server threads|reactor\n"
+                "  --server-threads N   (reactor threads, default: all cores)\n"
+                "  --server-cpu-units N (echo server runs cpu_work(N) per message before echoing it)\n"
+                "  --server-compute inline|pool|coroutines (on the reactor thread, a compute pool that\n"
+                "                        posts results back, or the handler hopping onto it; reactor only\n"
+                "                        for the last two)\n"
+                "  --compute-threads N  (compute pool threads, default: all cores)\n"
+                "  --server-only        (run only the echo server, on --bind, until SIGINT/SIGTERM)\n"
+                "  --bind ADDR[:PORT]   (listen address for --server-only and --coordinator; default loopback)\n"
+                "  --client --target HOST:PORT (run the I/O suites against a remote --server-only)\n"
+                "  --join HOST:PORT     (client: start every row on a coordinator's barrier, report to it)\n"
+                "  --coordinator --clients N (wait for N --join clients, merge their rows)\n"
+                "  --workers N          (coroutines_mt scheduler threads, default: all cores)\n"
+                "  --spawn-tasks N      (children per spawn benchmark run)\n"
+                "  --spawn-heap-mb N    (pre-touched parent heap for the large-RSS spawn runs)\n"
+                "  --spawn-exec PATH    (program run by fork_exec and posix_spawn)\n"
+                "  --pin compact|scatter|LIST (client worker i -> i-th CPU; LIST like 0-3,8)\n"
+                "  --server-cpus LIST   (CPUs for the echo server's threads)\n"
+                "  --numa none|local    (bind pinned threads' memory to their CPUs' nodes)\n"
+                "  --timers N           (timer wheel benchmark with N pending timers)\n"
+                "  --timer-span-ms N    (timer delays are spread over 1..N ms)\n"
+                "  --mem-budget-mb N    (double concurrency per model until its footprint exceeds N MiB)\n"
+                "  --sweep-max N        (upper bound for that sweep)\n";
             std::exit(0);
         }
     }
@@ -90,574 +553,6138 @@ static Config parse_args(int argc, char** argv) {
     if (cfg.tasks < 1) cfg.tasks = 1;
     if (cfg.concurrency < 1) cfg.concurrency = 1;
     if (cfg.repeats < 1) cfg.repeats = 1;
-    if (cfg.warmup < 0) cfg.warmup = 0;
+    if (cfg.warmup < -1) cfg.warmup = 0;
+    if (cfg.target_ci < 0) cfg.target_ci = 0;
+    if (cfg.max_repeats < cfg.repeats) cfg.max_repeats = cfg.repeats;
+    if (cfg.time_budget_s < 0) cfg.time_budget_s = 0;
+    if (cfg.requests_per_conn < 1) cfg.requests_per_conn = 1;
+    if (cfg.pipeline_depth < 1) cfg.pipeline_depth = 1;
+    if (cfg.spawn_tasks < 1) cfg.spawn_tasks = 1;
+    if (cfg.grain < 1) cfg.grain = 1;
+    if (cfg.quantum_us < 0) cfg.quantum_us = 0;
+    if (cfg.timers < 0) cfg.timers = 0;
+    if (cfg.timer_span_ms < 1) cfg.timer_span_ms = 1;
+    if (cfg.mem_budget_mb < 0) cfg.mem_budget_mb = 0;
+    if (cfg.sweep_max < cfg.concurrency) cfg.sweep_max = cfg.concurrency;
+    if (cfg.spawn_heap_mb < 0) cfg.spawn_heap_mb = 0;
+    if (cfg.kernel != "scalar" && cfg.kernel != "simd") {
+        std::cerr << "Unknown kernel '" << cfg.kernel << "'\n";
+        std::exit(1);
+    }
+    if (cfg.arm != "batched" && cfg.arm != "syscall") {
+        std::cerr << "Unknown arm mode '" << cfg.arm << "'\n";
+        std::exit(1);
+    }
+    if (cfg.transport != "tcp" && cfg.transport != "tcp6" && cfg.transport != "unix" && cfg.transport != "socketpair") {
+        std::cerr << "Unknown transport '" << cfg.transport << "'\n";
+        std::exit(1);
+    }
+    bool echo_ok = cfg.echo == "copy";
+#if defined(__linux__)
+    echo_ok |= cfg.echo == "splice";
+#endif
+    if (!echo_ok) {
+        std::cerr << "Echo mode '" << cfg.echo << "' is not available on this platform\n";
+        std::exit(1);
+    }
+    if (cfg.echo_buf_kb < 1) cfg.echo_buf_kb = 1;
+    if (cfg.server_cpu_units < 0) cfg.server_cpu_units = 0;
+    if (cfg.clients < 1) cfg.clients = 1;
+    const char* role_error = nullptr;
+    const bool tcp = cfg.transport == "tcp" || cfg.transport == "tcp6";
+    if ((int)cfg.server_only + (int)cfg.client + (int)cfg.coordinator > 1) role_error = "pick one of --server-only, --client and --coordinator";
+    else if (cfg.client && cfg.target.empty()) role_error = "--client needs --target HOST:PORT";
+    else if (cfg.client && !tcp) role_error = "--client needs --transport tcp or tcp6";
+    else if (cfg.client && !cfg.sweep.empty()) role_error = "--sweep does not run in --client mode";
+    else if (!cfg.target.empty() && !cfg.client) role_error = "--target needs --client";
+    else if (!cfg.join.empty() && !cfg.client) role_error = "--join needs --client";
+    else if (!cfg.join.empty() && (cfg.warmup < 0 || cfg.target_ci > 0))
+        role_error = "--join needs a fixed run count: --warmup auto and --target-ci stop each client at a different run";
+    else if (cfg.coordinator && cfg.bind.empty()) role_error = "--coordinator needs --bind [ADDR]:PORT";
+    else if (!cfg.bind.empty() && !cfg.server_only && !cfg.coordinator) role_error = "--bind needs --server-only or --coordinator";
+    else if (!cfg.bind.empty() && cfg.server_only && !tcp) role_error = "--bind needs --transport tcp or tcp6";
+    if (role_error) {
+        std::cerr << role_error << "\n";
+        std::exit(1);
+    }
+    if (cfg.server_compute != "inline" && cfg.server_compute != "pool" && cfg.server_compute != "coroutines") {
+        std::cerr << "Unknown server compute mode '" << cfg.server_compute << "'\n";
+        std::exit(1);
+    }
+    if (cfg.server_cpu_units > 0) {
+        // The compute server parses MsgHeader framing; the splice path and
+        // the streaming rows send raw bytes.
+        const char* clash = cfg.echo == "splice" ? "--echo splice"
+                          : cfg.stream_mb > 0     ? "--stream-mb"
+                          : cfg.server_compute != "inline" && cfg.server != "reactor" ? "--server threads (use reactor)"
+                          : nullptr;
+        if (clash) {
+            std::cerr << "--server-cpu-units does not combine with " << clash << "\n";
+            std::exit(1);
+        }
+    }
+    if (cfg.stream_mb < 0) cfg.stream_mb = 0;
+    if (cfg.stream_conns < 1) cfg.stream_conns = 1;
+    if (cfg.stream_chunk_kb < 1) cfg.stream_chunk_kb = 1;
+    bool switch_ok = false;
+#if defined(BENCH_HAVE_FIBER_ASM)
+    switch_ok |= cfg.fiber_switch == "asm";
+#endif
+#if defined(BENCH_HAVE_UCONTEXT)
+    switch_ok |= cfg.fiber_switch == "ucontext";
+#endif
+    if (!switch_ok) {
+        std::cerr << "Fiber switch '" << cfg.fiber_switch << "' is not available on this platform\n";
+        std::exit(1);
+    }
+    if (cfg.fiber_stack_kb < 8) cfg.fiber_stack_kb = 8;
+    if (cfg.rate < 0) cfg.rate = 0;
+    if (cfg.arrival != "poisson" && cfg.arrival != "uniform") {
+        std::cerr << "Unknown arrival process '" << cfg.arrival << "'\n";
+        std::exit(1);
+    }
+    if (cfg.numa != "none" && cfg.numa != "local") {
+        std::cerr << "Unknown numa mode '" << cfg.numa << "'\n";
+        std::exit(1);
+    }
+    resolve_placement(cfg);
     return cfg;
 }
 
-struct Result {
-    std::string model;
-    std::vector<double> runs;
-};
-
-static double median(std::vector<double> v) {
-    std::sort(v.begin(), v.end());
-    return v[v.size() / 2];
-}
-static double minv(const std::vector<double>& v) {
-    return *std::min_element(v.begin(), v.end());
-}
-static double maxv(const std::vector<double>& v) {
-    return *std::max_element(v.begin(), v.end());
+static uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        steady_clock::now().time_since_epoch()).count();
 }
 
-static void print_md_table(const std::string& title, const std::vector<Result>& results) {
-    std::cout << "### " << title << "\n\n";
-    std::cout << "| Model | Median | Min | Max | Runs |\n";
-    std::cout << "|------:|-------:|----:|----:|-----:|\n";
-    for (const auto& r : results) {
-        std::cout << "| " << r.model
-                  << " | " << fmt_sec(median(r.runs))
-                  << " | " << fmt_sec(minv(r.runs))
-                  << " | " << fmt_sec(maxv(r.runs))
-                  << " | " << r.runs.size()
-                  << " |\n";
-    }
-    std::cout << "\n";
+static std::string fmt_us(uint64_t ns) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << (double)ns / 1000.0 << " us";
+    return oss.str();
 }
 
-template <class Fn>
-static Result run_repeated(const Config& cfg, const std::string& label, Fn fn) {
-    for (int i = 0; i < cfg.warmup; i++) fn();
+// HDR-style log-linear latency histogram in nanoseconds: exact below 64 ns,
+// then 32 sub-buckets per power of two (<= ~3% error), capped at ~18 min.
+// Plain-old-data so it can live in MAP_SHARED memory for the fork models.
+struct Histogram {
+    static constexpr int kLinear = 64;
+    static constexpr int kSub = 32;
+    static constexpr int kMaxMsb = 39;
+    static constexpr int kBuckets = kLinear + (kMaxMsb - 5) * kSub;
 
-    Result r;
-    r.model = label;
-    r.runs.reserve(cfg.repeats);
+    uint64_t counts[kBuckets];
+    uint64_t count;
+    uint64_t max;
 
-    for (int i = 0; i < cfg.repeats; i++) {
-        double t0 = seconds_now();
-        fn();
-        r.runs.push_back(seconds_now() - t0);
+    static int index_of(uint64_t v) {
+        if (v < (uint64_t)kLinear) return (int)v;
+        int msb = 63 - __builtin_clzll(v);
+        if (msb > kMaxMsb) return kBuckets - 1;
+        int shift = msb - 5;
+        return kLinear + (shift - 1) * kSub + (int)((v >> shift) - kSub);
     }
-    return r;
-}
 
-static uint32_t cpu_work(int units) {
-    uint32_t acc = 0;
-    for (int i = 0; i < units; i++) {
-        acc = acc * 1664525u + 1013904223u + (uint32_t)i;
+    static uint64_t value_at(int idx) {
+        if (idx < kLinear) return (uint64_t)idx;
+        int k = idx - kLinear;
+        int shift = k / kSub + 1;
+        uint64_t lower = (uint64_t)(k % kSub + kSub) << shift;
+        return lower + ((1ull << shift) >> 1);
     }
-    return acc;
-}
-
-static void cpu_threads(const Config& cfg) {
-    std::atomic<int> idx{0};
-    std::vector<std::thread> workers;
-    workers.reserve(cfg.concurrency);
-
-    std::atomic<uint32_t> checksum{0};
 
-    for (int t = 0; t < cfg.concurrency; t++) {
-        workers.emplace_back([&] {
-            uint32_t local = 0;
-            while (true) {
-                int i = idx.fetch_add(1, std::memory_order_relaxed);
-                if (i >= cfg.tasks) break;
-                local ^= cpu_work(cfg.cpu_units);
-            }
-            checksum.fetch_xor(local, std::memory_order_relaxed);
-        });
+    void record(uint64_t v) {
+        counts[index_of(v)]++;
+        count++;
+        if (v > max) max = v;
     }
-    for (auto& th : workers) th.join();
-    (void)checksum.load();
-}
 
-static void cpu_processes(const Config& cfg) {
-    int launched = 0;
-    int completed = 0;
+    void merge(const Histogram& o) {
+        for (int i = 0; i < kBuckets; i++) counts[i] += o.counts[i];
+        count += o.count;
+        if (o.max > max) max = o.max;
+    }
 
-    while (completed < cfg.tasks) {
-        while (launched - completed < cfg.concurrency && launched < cfg.tasks) {
-            pid_t pid = ::fork();
-            if (pid == 0) {
-                (void)cpu_work(cfg.cpu_units);
-                _exit(0);
-            }
-            launched++;
+    // merge() into a histogram shared with other processes.
+    void merge_atomic(const Histogram& o) {
+        if (o.count == 0) return;
+        for (int i = 0; i < kBuckets; i++) {
+            if (o.counts[i]) __atomic_fetch_add(&counts[i], o.counts[i], __ATOMIC_RELAXED);
         }
-        int status = 0;
-        (void)::wait(&status);
-        completed++;
+        __atomic_fetch_add(&count, o.count, __ATOMIC_RELAXED);
+        uint64_t cur = __atomic_load_n(&max, __ATOMIC_RELAXED);
+        while (o.max > cur &&
+               !__atomic_compare_exchange_n(&max, &cur, o.max, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
     }
-}
 
-struct CpuTask {
-    struct promise_type {
-        CpuTask get_return_object() {
-            return CpuTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+    uint64_t percentile(double p) const {
+        if (count == 0) return 0;
+        uint64_t target = (uint64_t)std::ceil(p / 100.0 * (double)count);
+        if (target < 1) target = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; i++) {
+            seen += counts[i];
+            if (seen >= target) return std::min(value_at(i), max);
         }
-        std::suspend_always initial_suspend() noexcept { return {}; }
-        std::suspend_always final_suspend() noexcept { return {}; }
-        void return_void() noexcept {}
-        void unhandled_exception() { std::terminate(); }
-    };
-
-    std::coroutine_handle<promise_type> h{};
-
-    CpuTask() = default;
-    explicit CpuTask(std::coroutine_handle<promise_type> h_) : h(h_) {}
-
-    CpuTask(const CpuTask&) = delete;
-    CpuTask& operator=(const CpuTask&) = delete;
+        return max;
+    }
+};
 
-    CpuTask(CpuTask&& o) noexcept : h(o.h) { o.h = {}; }
+// Per-request phases: connect done, first echoed byte received, full echo
+// received. The first request on a connection is timed from just before
+// socket(), so it includes the handshake; later keep-alive requests on the
+// same connection are timed from their own send. In open-loop runs the first
+// request is timed from its scheduled arrival instead, and start_lag, late
+// and dropped track how far behind schedule tasks started. The cooperative
+// CPU scheduler reuses start_lag for each resume's wait in the ready queue,
+// and adds launch-to-finish turnaround per task, yields, and the time spent
+// between tasks rather than in them.
+struct LatencySet {
+    Histogram connect{};
+    Histogram first_byte{};
+    Histogram total{};
+    Histogram start_lag{};
+    Histogram turnaround{};
+    uint64_t late = 0;
+    uint64_t dropped = 0;
+    uint64_t yields = 0;
+    uint64_t sched_ns = 0;
+    uint64_t capped_depth = 0; // smallest pipeline depth fitting_depth cut a connection to; 0: none
 
-    CpuTask& operator=(CpuTask&& o) noexcept {
-        if (this != &o) {
-            if (h) h.destroy();
-            h = o.h;
-            o.h = {};
-        }
-        return *this;
+    void merge(const LatencySet& o) {
+        connect.merge(o.connect);
+        first_byte.merge(o.first_byte);
+        total.merge(o.total);
+        start_lag.merge(o.start_lag);
+        turnaround.merge(o.turnaround);
+        late += o.late;
+        dropped += o.dropped;
+        yields += o.yields;
+        sched_ns += o.sched_ns;
+        if (o.capped_depth && (!capped_depth || o.capped_depth < capped_depth)) capped_depth = o.capped_depth;
     }
-
-    ~CpuTask() {
-        if (h) h.destroy();
+    void merge_atomic(const LatencySet& o) {
+        connect.merge_atomic(o.connect);
+        first_byte.merge_atomic(o.first_byte);
+        total.merge_atomic(o.total);
+        start_lag.merge_atomic(o.start_lag);
+        turnaround.merge_atomic(o.turnaround);
+        __atomic_fetch_add(&late, o.late, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&dropped, o.dropped, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&yields, o.yields, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&sched_ns, o.sched_ns, __ATOMIC_RELAXED);
+        uint64_t d = __atomic_load_n(&capped_depth, __ATOMIC_RELAXED);
+        while (o.capped_depth && (!d || o.capped_depth < d) &&
+               !__atomic_compare_exchange_n(&capped_depth, &d, o.capped_depth, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
     }
-
-    bool done() const noexcept { return !h || h.done(); }
-    void resume() { if (h && !h.done()) h.resume(); }
 };
 
-static CpuTask cpu_coroutine_job(int units, int chunk, std::atomic<uint32_t>* out) {
-    uint32_t acc = 0;
-    int done = 0;
-    while (done < units) {
-        int step = std::min(chunk, units - done);
-        for (int i = 0; i < step; i++) {
-            acc = acc * 1664525u + 1013904223u + (uint32_t)(done + i);
-        }
-        done += step;
-        co_await std::suspend_always{}; // cooperative yield
-    }
-    out->fetch_xor(acc, std::memory_order_relaxed);
-    co_return;
-}
-
-static void cpu_coroutines(const Config& cfg) {
-    const int chunk = 5000;
-    std::atomic<uint32_t> checksum{0};
+// Resource usage of one or more runs. Hardware counters are -1 when the
+// PMU (or perf_event_open) is unavailable.
+struct Counters {
+    int64_t cycles = 0;
+    int64_t instructions = 0;
+    int64_t cache_misses = 0;
+    int64_t ctx_switches = 0;
+    int64_t voluntary = 0;
+    int64_t involuntary = 0;
+    int64_t minor_faults = 0;
+    int64_t loop_ctl = 0;  // client event loop registration syscalls
+    int64_t loop_wait = 0; // client event loop wait syscalls
+    double user_s = 0;
+    double sys_s = 0;
 
-    int launched = 0;
-    int finished = 0;
+    void add(const Counters& o) {
+        auto sum = [](int64_t& a, int64_t b) { a = (a < 0 || b < 0) ? -1 : a + b; };
+        sum(cycles, o.cycles);
+        sum(instructions, o.instructions);
+        sum(cache_misses, o.cache_misses);
+        sum(ctx_switches, o.ctx_switches);
+        voluntary += o.voluntary;
+        involuntary += o.involuntary;
+        minor_faults += o.minor_faults;
+        loop_ctl += o.loop_ctl;
+        loop_wait += o.loop_wait;
+        user_s += o.user_s;
+        sys_s += o.sys_s;
+    }
+};
 
-    std::vector<CpuTask> active;
-    active.reserve((size_t)cfg.concurrency);
+// Client event loops add their syscall counts here when a run ends; the
+// server's reactors don't, so the loop columns describe the client only.
+static std::atomic<int64_t> g_loop_ctl{0};
+static std::atomic<int64_t> g_loop_wait{0};
 
-    auto launch_one = [&]() {
-        active.emplace_back(cpu_coroutine_job(cfg.cpu_units, chunk, &checksum));
-        active.back().resume();
-        launched++;
-    };
+// Live pre-forked children. RUSAGE_CHILDREN only covers reaped children and
+// the pool's are reaped when it goes away, so until then the sampler reads
+// their usage from /proc.
+static std::vector<pid_t> g_live_children;
 
-    while (launched < cfg.tasks && (int)active.size() < cfg.concurrency) {
-        launch_one();
+#if defined(__linux__)
+static void add_proc_usage(pid_t pid, Counters& c) {
+    static const double tick = 1.0 / (double)::sysconf(_SC_CLK_TCK);
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(stat, line)) return;
+    size_t paren = line.rfind(')');
+    if (paren == std::string::npos) return;
+    std::istringstream in(line.substr(paren + 1));
+    std::string field;
+    int64_t minflt = 0, utime = 0, stime = 0;
+    // Fields after the command name start at 3 (state): minflt is 10,
+    // utime 14, stime 15.
+    for (int i = 3; i <= 15 && in >> field; i++) {
+        if (i == 10) minflt = std::atoll(field.c_str());
+        if (i == 14) utime = std::atoll(field.c_str());
+        if (i == 15) stime = std::atoll(field.c_str());
     }
+    c.minor_faults += minflt;
+    c.user_s += (double)utime * tick;
+    c.sys_s += (double)stime * tick;
 
-    while (finished < cfg.tasks) {
-        for (size_t i = 0; i < active.size();) {
-            if (active[i].done()) {
-                active[i] = std::move(active.back());
-                active.pop_back();
-                finished++;
-                if (launched < cfg.tasks) launch_one();
-            } else {
-                active[i].resume();
-                i++;
-            }
-        }
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string key;
+    while (status >> key) {
+        int64_t n = 0;
+        if (key == "voluntary_ctxt_switches:" && status >> n) c.voluntary += n;
+        else if (key == "nonvoluntary_ctxt_switches:" && status >> n) c.involuntary += n;
+        status.ignore(INT_MAX, '\n');
     }
-
-    (void)checksum.load();
 }
+#endif
 
-struct EchoServer {
-    int listen_fd = -1;
-    uint16_t port = 0;
-    std::thread accept_thread;
+// Counts for the whole process tree. The perf events are opened with
+// inherit=1 during static initialisation, before any worker exists, so every
+// thread and child created later gets a child event. Reading the parent event
+// sums the live children's counts with those already folded in by the ones
+// that exited, so pool workers, reactor threads and pre-forked children are
+// counted while they run (the echo server's threads too, which are the same
+// for every model). getrusage() covers all of this process's threads plus
+// reaped children, and g_live_children adds the pre-forked ones: a child
+// that is reaped between two samples moves from the /proc sum to
+// RUSAGE_CHILDREN with its whole lifetime, so deltas stay exact.
+class CounterSampler {
+public:
+    CounterSampler() {
+#if defined(BENCH_HAVE_PERF)
+        fds_[0] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds_[1] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds_[2] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds_[3] = open_event(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+#endif
+    }
+    ~CounterSampler() {
+        for (int fd : fds_) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+    CounterSampler(const CounterSampler&) = delete;
+    CounterSampler& operator=(const CounterSampler&) = delete;
 
-    bool start(int backlog) {
-        listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
-        if (listen_fd < 0) return false;
+    // Absolute totals; subtract two samples with delta().
+    Counters sample() const {
+        Counters c;
+        c.cycles = read_event(fds_[0]);
+        c.instructions = read_event(fds_[1]);
+        c.cache_misses = read_event(fds_[2]);
+        c.ctx_switches = read_event(fds_[3]);
+        c.loop_ctl = g_loop_ctl.load(std::memory_order_relaxed);
+        c.loop_wait = g_loop_wait.load(std::memory_order_relaxed);
+        for (int who : {RUSAGE_SELF, RUSAGE_CHILDREN}) {
+            rusage ru{};
+            if (::getrusage(who, &ru) < 0) continue;
+            c.voluntary += ru.ru_nvcsw;
+            c.involuntary += ru.ru_nivcsw;
+            c.minor_faults += ru.ru_minflt;
+            c.user_s += (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec / 1e6;
+            c.sys_s += (double)ru.ru_stime.tv_sec + (double)ru.ru_stime.tv_usec / 1e6;
+        }
+#if defined(__linux__)
+        for (pid_t pid : g_live_children) add_proc_usage(pid, c);
+#endif
+        return c;
+    }
 
-        int one = 1;
-        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    static Counters delta(const Counters& a, const Counters& b) {
+        auto sub = [](int64_t x, int64_t y) { return (x < 0 || y < 0) ? -1 : y - x; };
+        Counters d;
+        d.cycles = sub(a.cycles, b.cycles);
+        d.instructions = sub(a.instructions, b.instructions);
+        d.cache_misses = sub(a.cache_misses, b.cache_misses);
+        d.ctx_switches = sub(a.ctx_switches, b.ctx_switches);
+        d.voluntary = b.voluntary - a.voluntary;
+        d.involuntary = b.involuntary - a.involuntary;
+        d.minor_faults = b.minor_faults - a.minor_faults;
+        d.loop_ctl = b.loop_ctl - a.loop_ctl;
+        d.loop_wait = b.loop_wait - a.loop_wait;
+        d.user_s = b.user_s - a.user_s;
+        d.sys_s = b.sys_s - a.sys_s;
+        return d;
+    }
 
-        sockaddr_in addr{};
-        addr.sin_family = AF_INET;
-        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-        addr.sin_port = 0;
+private:
+#if defined(BENCH_HAVE_PERF)
+    // Kernel-side counting needs perf_event_paranoid < 2 (or root); fall
+    // back to user-only counts before giving up on the event.
+    static int open_event(uint32_t type, uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.inherit = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = (int)::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (fd < 0 && errno == EACCES) {
+            attr.exclude_kernel = 1;
+            fd = (int)::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        }
+        return fd;
+    }
 
-        if (::bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0) return false;
-        if (::listen(listen_fd, backlog) < 0) return false;
+    // Scales for multiplexing when the PMU had to share counters.
+    static int64_t read_event(int fd) {
+        if (fd < 0) return -1;
+        uint64_t v[3] = {};
+        if (::read(fd, v, sizeof(v)) != (ssize_t)sizeof(v)) return -1;
+        if (v[2] == 0) return 0;
+        return (int64_t)((double)v[0] * (double)v[1] / (double)v[2]);
+    }
+#else
+    static int64_t read_event(int) { return -1; }
+#endif
 
-        socklen_t len = sizeof(addr);
-        if (::getsockname(listen_fd, (sockaddr*)&addr, &len) < 0) return false;
-        port = ntohs(addr.sin_port);
+    int fds_[4] = {-1, -1, -1, -1};
+};
 
-        accept_thread = std::thread([this] {
-            while (true) {
-                int c = ::accept(listen_fd, nullptr, nullptr);
-                if (c < 0) break;
+static const CounterSampler g_counters;
 
-                std::thread([c] {
-                    char buf[4096];
-                    while (true) {
-                        ssize_t n = ::read(c, buf, sizeof(buf));
-                        if (n <= 0) break;
-                        ssize_t off = 0;
-                        while (off < n) {
-                            ssize_t w = ::write(c, buf + off, (size_t)(n - off));
-                            if (w <= 0) break;
-                            off += w;
-                        }
-                    }
-                    ::close(c);
-                }).detach();
-            }
-        });
 
-        return true;
+// Resident set size of this process in KiB, or -1 if unknown.
+static int64_t current_rss_kb() {
+#if defined(__linux__)
+    std::ifstream f("/proc/self/status");
+    std::string key;
+    while (f >> key) {
+        int64_t kb = 0;
+        if (key == "VmRSS:" && f >> kb) return kb;
+        f.ignore(INT_MAX, '\n');
     }
+    return -1;
+#elif defined(__APPLE__)
+    mach_task_basic_info info{};
+    mach_msg_type_number_t n = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &n) != KERN_SUCCESS) return -1;
+    return (int64_t)(info.resident_size / 1024);
+#else
+    return -1;
+#endif
+}
 
-    void stop() {
-        if (listen_fd >= 0) {
-            ::close(listen_fd);
-            listen_fd = -1;
-        }
-        if (accept_thread.joinable()) accept_thread.join();
+// Peak RSS since the last reset_peak_rss(). Linux resets VmHWM through
+// clear_refs; macOS cannot reset resident_size_max, so there the peak is
+// since process start.
+static int64_t peak_rss_kb() {
+#if defined(__linux__)
+    std::ifstream f("/proc/self/status");
+    std::string key;
+    while (f >> key) {
+        int64_t kb = 0;
+        if (key == "VmHWM:" && f >> kb) return kb;
+        f.ignore(INT_MAX, '\n');
     }
-};
-
-static int set_timeouts(int fd, int timeout_ms) {
-    timeval tv{};
-    tv.tv_sec = timeout_ms / 1000;
-    tv.tv_usec = (timeout_ms % 1000) * 1000;
-    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) return -1;
-    if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0) return -1;
-    return 0;
+    return -1;
+#elif defined(__APPLE__)
+    mach_task_basic_info info{};
+    mach_msg_type_number_t n = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &n) != KERN_SUCCESS) return -1;
+    return (int64_t)(info.resident_size_max / 1024);
+#else
+    return -1;
+#endif
 }
 
-static void io_one_blocking(uint16_t port, int payload_size, int timeout_ms) {
-    int s = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (s < 0) return;
-    (void)set_timeouts(s, timeout_ms);
+static void reset_peak_rss() {
+#if defined(__linux__)
+    std::ofstream f("/proc/self/clear_refs");
+    f << "5";
+#endif
+}
 
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-    addr.sin_port = htons(port);
+// Largest child RSS seen by reap_child() since the last reset; the fork
+// models reap through it so each run knows what one child cost.
+static int64_t g_child_peak_kb = 0;
 
-    if (::connect(s, (sockaddr*)&addr, sizeof(addr)) < 0) {
-        ::close(s);
-        return;
+static pid_t reap_child(int* status) {
+    rusage ru{};
+    pid_t pid = ::wait4(-1, status, 0, &ru);
+    if (pid > 0) {
+#if defined(__APPLE__)
+        int64_t kb = (int64_t)ru.ru_maxrss / 1024;
+#else
+        int64_t kb = (int64_t)ru.ru_maxrss;
+#endif
+        g_child_peak_kb = std::max(g_child_peak_kb, kb);
     }
+    return pid;
+}
 
-    std::vector<char> payload((size_t)payload_size, 'x');
+// Memory of one model: the parent's peak RSS during a run and how far it
+// rose above the pre-run RSS, plus the biggest single child for fork models.
+// Child RSS includes pages still shared copy-on-write with the parent, so it
+// is an upper bound on what a process really costs.
+struct MemoryUsage {
+    int64_t peak_kb = -1;
+    int64_t growth_kb = -1;
+    int64_t child_kb = 0;
+    int inflight = 1; // tasks alive at once: min(concurrency, tasks)
 
-    size_t off = 0;
-    while (off < payload.size()) {
-        ssize_t w = ::send(s, payload.data() + off, payload.size() - off, 0);
-        if (w <= 0) { ::close(s); return; }
-        off += (size_t)w;
+    // What one in-flight task costs: parent growth spread over the tasks,
+    // or one child's RSS when the model forks.
+    double per_task_kb() const {
+        if (child_kb > 0) return (double)child_kb + (double)std::max<int64_t>(growth_kb, 0) / inflight;
+        return (double)std::max<int64_t>(growth_kb, 0) / inflight;
     }
+};
 
-    std::vector<char> buf(payload.size());
-    size_t got = 0;
-    while (got < buf.size()) {
-        ssize_t n = ::recv(s, buf.data() + got, buf.size() - got, 0);
-        if (n <= 0) { ::close(s); return; }
-        got += (size_t)n;
-    }
+// What one timed run recorded besides its wall time.
+struct RunSample {
+    LatencySet latency{};
+    Counters counters{};
+    MemoryUsage memory{};
+};
 
-    ::close(s);
-}
+struct Result {
+    std::string model;
+    std::vector<double> runs;
+    LatencySet latency{};  // merged over the counted runs
+    Counters counters{};   // summed over the counted runs
+    MemoryUsage memory{};  // worst counted run
+    int counted = 0;       // runs the three above cover: those run_stats keeps
+    int tasks = 0;         // tasks per run, for per-task counter columns
+    int warmups = -1;      // untimed runs --warmup auto chose; -1 when fixed
+    std::vector<std::shared_ptr<RunSample>> samples; // per timed run, until count_kept_runs()
+};
 
-static void io_threads(const Config& cfg, uint16_t port) {
-    std::atomic<int> idx{0};
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+static double minv(const std::vector<double>& v) {
+    return *std::min_element(v.begin(), v.end());
+}
+static double maxv(const std::vector<double>& v) {
+    return *std::max_element(v.begin(), v.end());
+}
+
+// Statistics over one model's timed runs. Runs more than 3.5 scaled MADs
+// from the median (modified z-score, Iglewicz-Hoaglin; the MAD is floored at
+// 5% of the median, so runs within 17.5% of it are always kept) are left out
+// of everything else here. ci_lo..ci_hi is the distribution-free 95% interval
+// of the median from order statistics, so it needs ~10 runs to be narrower
+// than the Min..Max range.
+struct RunStats {
+    double median = 0, min = 0, max = 0, ci_lo = 0, ci_hi = 0, cv = 0;
+    double fence_lo = 0, fence_hi = 0; // runs outside are outliers
+    int kept = 0, outliers = 0;
+
+    double ci_rel() const { return median > 0 ? (ci_hi - ci_lo) / 2 / median : 0; }
+};
+
+static RunStats run_stats(std::vector<double> v) {
+    RunStats s;
+    if (v.empty()) return s;
+    double med = median(v);
+    std::vector<double> dev;
+    for (double x : v) dev.push_back(std::fabs(x - med));
+    // The floor keeps near-identical runs from making ordinary jitter an
+    // outlier: nothing within 17.5% (3.5 x 5%) of the median is rejected.
+    double mad = std::max(median(dev) * 1.4826, 0.05 * med);
+    s.fence_lo = med - 3.5 * mad;
+    s.fence_hi = med + 3.5 * mad;
+    if (mad > 0) {
+        v.erase(std::remove_if(v.begin(), v.end(), [&](double x) { return std::fabs(x - med) / mad > 3.5; }), v.end());
+    }
+    std::sort(v.begin(), v.end());
+    const int n = (int)v.size();
+    s.kept = n;
+    s.outliers = (int)dev.size() - n;
+    s.median = v[n / 2];
+    s.min = v.front();
+    s.max = v.back();
+
+    double mean = 0, var = 0;
+    for (double x : v) mean += x;
+    mean /= n;
+    for (double x : v) var += (x - mean) * (x - mean);
+    if (n > 1 && mean > 0) s.cv = std::sqrt(var / (n - 1)) / mean;
+
+    double h = 1.96 * std::sqrt((double)n) / 2;
+    s.ci_lo = v[std::max(0, (int)std::floor(n / 2.0 - h) - 1)];
+    s.ci_hi = v[std::min(n - 1, (int)std::ceil(1 + n / 2.0 + h) - 1)];
+    return s;
+}
+
+// Wall time of the runs st keeps: the denominator for rates whose numerator
+// comes from the counted runs' histograms.
+static double kept_seconds(const std::vector<double>& runs, const RunStats& st) {
+    double sum = 0;
+    for (double t : runs) sum += t < st.fence_lo || t > st.fence_hi ? 0 : t;
+    return sum;
+}
+
+// The pipeline depth an I/O row's connections ran at: --pipeline-depth unless
+// fitting_depth cut it. -1 for rows without echoed requests.
+static int64_t effective_depth(const Config& cfg, const Result& r) {
+    if (r.latency.capped_depth) return (int64_t)r.latency.capped_depth;
+    return r.latency.total.count > 0 ? cfg.pipeline_depth : -1;
+}
+
+static std::string fmt_pct(double x) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << x * 100 << "%";
+    return oss.str();
+}
+
+// "12", "12 (1 outlier)", "12, 3 warmup" ...
+static std::string fmt_runs(const Result& r, const RunStats& st) {
+    std::ostringstream oss;
+    oss << st.kept;
+    if (st.outliers) oss << " (" << st.outliers << (st.outliers == 1 ? " outlier)" : " outliers)");
+    if (r.warmups >= 0) oss << ", " << r.warmups << " warmup";
+    return oss.str();
+}
+
+static std::string fmt_per(int64_t v, double n) {
+    if (v < 0) return "-";
+    std::ostringstream oss;
+    double x = (double)v / n;
+    oss << std::fixed << std::setprecision(x < 10 ? 2 : 0) << x;
+    return oss.str();
+}
+
+// Per-task averages over the timed runs; user/sys time is per run.
+static void print_counters_table(const std::vector<Result>& results) {
+    std::cout << "#### Counters (per task)\n\n";
+    std::cout << "| Model | Cycles | Instr | IPC | Cache misses | Ctx switches | Voluntary | Involuntary | Minor faults | Loop ctl | Loop wait | User/run | Sys/run |\n";
+    std::cout << "|------:|-------:|------:|----:|-------------:|-------------:|----------:|------------:|-------------:|---------:|----------:|---------:|--------:|\n";
+    for (const auto& r : results) {
+        const Counters& c = r.counters;
+        double runs = (double)std::max(1, r.counted);
+        double n = runs * (double)std::max(1, r.tasks);
+        std::ostringstream ipc;
+        if (c.cycles > 0 && c.instructions >= 0) ipc << std::fixed << std::setprecision(2) << (double)c.instructions / (double)c.cycles;
+        else ipc << "-";
+        std::cout << "| " << r.model
+                  << " | " << fmt_per(c.cycles, n)
+                  << " | " << fmt_per(c.instructions, n)
+                  << " | " << ipc.str()
+                  << " | " << fmt_per(c.cache_misses, n)
+                  << " | " << fmt_per(c.ctx_switches, n)
+                  << " | " << fmt_per(c.voluntary, n)
+                  << " | " << fmt_per(c.involuntary, n)
+                  << " | " << fmt_per(c.minor_faults, n)
+                  << " | " << fmt_per(c.loop_ctl, n)
+                  << " | " << fmt_per(c.loop_wait, n)
+                  << " | " << fmt_sec(c.user_s / runs)
+                  << " | " << fmt_sec(c.sys_s / runs)
+                  << " |\n";
+    }
+    std::cout << "\n";
+}
+
+static std::string fmt_kb(double kb) {
+    if (kb < 0) return "-";
+    std::ostringstream oss;
+    if (kb >= 10 * 1024) oss << std::fixed << std::setprecision(1) << kb / 1024 << " MiB";
+    else oss << std::fixed << std::setprecision(kb < 10 ? 2 : 0) << kb << " KiB";
+    return oss.str();
+}
+
+static void print_memory_table(const std::vector<Result>& results) {
+    std::cout << "#### Memory\n\n";
+    std::cout << "| Model | Peak RSS | Growth | Child RSS | Per task |\n";
+    std::cout << "|------:|---------:|-------:|----------:|---------:|\n";
+    for (const auto& r : results) {
+        const MemoryUsage& m = r.memory;
+        std::cout << "| " << r.model
+                  << " | " << fmt_kb((double)m.peak_kb)
+                  << " | " << fmt_kb((double)m.growth_kb)
+                  << " | " << (m.child_kb > 0 ? fmt_kb((double)m.child_kb) : "-")
+                  << " | " << (m.growth_kb < 0 ? "-" : fmt_kb(m.per_task_kb()))
+                  << " |\n";
+    }
+    std::cout << "\n";
+}
+
+// Blocking and io_uring clients run shallower than --pipeline-depth when the
+// window doesn't fit in the socket buffers (fitting_depth); such rows are
+// named under their table with the depth they ran at.
+static void print_depth_note(const std::vector<Result>& results) {
+    std::string capped;
+    for (const auto& r : results) {
+        if (!r.latency.capped_depth) continue;
+        capped += (capped.empty() ? "" : ", ") + r.model + " at " + std::to_string(r.latency.capped_depth);
+    }
+    if (!capped.empty()) std::cout << "Pipeline depth cut to fit the socket buffers: " << capped << ".\n\n";
+}
+
+static void print_md_table(const std::string& title, const std::vector<Result>& results) {
+    bool has_latency = false;
+    for (const auto& r : results) has_latency |= r.latency.total.count > 0;
+
+    std::cout << "### " << title << "\n\n";
+    if (!has_latency) {
+        std::cout << "| Model | Median | ±95% CI | CV | Min | Max | Runs |\n";
+        std::cout << "|------:|-------:|--------:|---:|----:|----:|-----:|\n";
+    } else {
+        std::cout << "| Model | Median | ±95% CI | CV | Min | Max | Runs | Req/s | p50 | p90 | p99 | p99.9 | Max latency |\n";
+        std::cout << "|------:|-------:|--------:|---:|----:|----:|-----:|------:|----:|----:|----:|------:|------------:|\n";
+    }
+    for (const auto& r : results) {
+        RunStats st = run_stats(r.runs);
+        std::cout << "| " << r.model
+                  << " | " << fmt_sec(st.median)
+                  << " | " << fmt_pct(st.ci_rel())
+                  << " | " << fmt_pct(st.cv)
+                  << " | " << fmt_sec(st.min)
+                  << " | " << fmt_sec(st.max)
+                  << " | " << fmt_runs(r, st);
+        if (has_latency) {
+            const Histogram& h = r.latency.total;
+            std::cout << " | " << (uint64_t)((double)h.count / kept_seconds(r.runs, st))
+                      << " | " << fmt_us(h.percentile(50))
+                      << " | " << fmt_us(h.percentile(90))
+                      << " | " << fmt_us(h.percentile(99))
+                      << " | " << fmt_us(h.percentile(99.9))
+                      << " | " << fmt_us(h.max);
+        }
+        std::cout << " |\n";
+    }
+    std::cout << "\n";
+    print_depth_note(results);
+
+    print_counters_table(results);
+    print_memory_table(results);
+
+    if (!has_latency) return;
+    std::cout << "#### Latency breakdown\n\n";
+    std::cout << "| Model | Connect p50 | Connect p99 | First byte p50 | First byte p99 | Echo p50 | Echo p99 |\n";
+    std::cout << "|------:|------------:|------------:|---------------:|---------------:|---------:|---------:|\n";
+    for (const auto& r : results) {
+        const LatencySet& l = r.latency;
+        std::cout << "| " << r.model
+                  << " | " << fmt_us(l.connect.percentile(50))
+                  << " | " << fmt_us(l.connect.percentile(99))
+                  << " | " << fmt_us(l.first_byte.percentile(50))
+                  << " | " << fmt_us(l.first_byte.percentile(99))
+                  << " | " << fmt_us(l.total.percentile(50))
+                  << " | " << fmt_us(l.total.percentile(99))
+                  << " |\n";
+    }
+    std::cout << "\n";
+}
+
+// Cooperative scheduler rows (those that record yields or turnaround):
+// overhead is time between tasks per switch (yield or finish); waits are
+// ready-queue time per resume; spread is the gap between the first and last
+// task finishing relative to its own launch.
+static void print_sched_table(const Config& cfg, const std::vector<Result>& results) {
+    bool any = false;
+    for (const auto& r : results) any |= r.latency.turnaround.count > 0;
+    if (!any) return;
+    std::cout << "#### Scheduling (" << (cfg.quantum_us > 0 ? std::to_string(cfg.quantum_us) + " us quantum" : "5000-unit chunks")
+              << ")\n\n";
+    std::cout << "| Model | Yields/task | Overhead/switch | Wait p50 | Wait p99 | Wait max | Turnaround p50 | Turnaround p99 | Spread |\n";
+    std::cout << "|------:|------------:|----------------:|---------:|---------:|---------:|---------------:|---------------:|-------:|\n";
+    for (const auto& r : results) {
+        const LatencySet& l = r.latency;
+        if (l.turnaround.count == 0) continue;
+        const double tasks = (double)l.turnaround.count;
+        std::ostringstream yields, overhead;
+        yields << std::fixed << std::setprecision(1) << (double)l.yields / tasks;
+        overhead << std::fixed << std::setprecision(1) << (double)l.sched_ns / ((double)l.yields + tasks) << " ns";
+        std::cout << "| " << r.model
+                  << " | " << yields.str()
+                  << " | " << overhead.str()
+                  << " | " << fmt_us(l.start_lag.percentile(50))
+                  << " | " << fmt_us(l.start_lag.percentile(99))
+                  << " | " << fmt_us(l.start_lag.max)
+                  << " | " << fmt_us(l.turnaround.percentile(50))
+                  << " | " << fmt_us(l.turnaround.percentile(99))
+                  << " | " << fmt_us(l.turnaround.max - l.turnaround.percentile(0))
+                  << " |\n";
+    }
+    std::cout << "\n";
+}
+
+// Open-loop rows: latency percentiles are measured from each task's scheduled
+// arrival, so time spent queued behind a slow server is included (no
+// coordinated omission). Achieved rate counts tasks that were not dropped.
+static void print_open_loop_table(const std::string& title, const Config& cfg, const std::vector<Result>& results) {
+    std::cout << "### " << title << "\n\n";
+    std::cout << "| Model | Target/s | Achieved/s | Late | Dropped | Lag p99 | p50 | p90 | p99 | p99.9 | Max latency |\n";
+    std::cout << "|------:|---------:|-----------:|-----:|--------:|--------:|----:|----:|----:|------:|------------:|\n";
+    for (const auto& r : results) {
+        const LatencySet& l = r.latency;
+        RunStats st = run_stats(r.runs);
+        double elapsed = kept_seconds(r.runs, st);
+        double started = (double)r.tasks * (double)r.counted - (double)l.dropped;
+        std::cout << "| " << r.model
+                  << " | " << cfg.rate
+                  << " | " << (uint64_t)(started / elapsed)
+                  << " | " << l.late
+                  << " | " << l.dropped
+                  << " | " << fmt_us(l.start_lag.percentile(99))
+                  << " | " << fmt_us(l.total.percentile(50))
+                  << " | " << fmt_us(l.total.percentile(90))
+                  << " | " << fmt_us(l.total.percentile(99))
+                  << " | " << fmt_us(l.total.percentile(99.9))
+                  << " | " << fmt_us(l.total.max)
+                  << " |\n";
+    }
+    std::cout << "\n";
+    print_depth_note(results);
+}
+
+// Streaming rows: GB/s is --stream-mb (one direction; as much again comes
+// back) over the median run. `total` holds one sample per connection that got
+// all of its bytes echoed, so Conns below --stream-conns means failures.
+static void print_stream_table(const std::string& title, const Config& cfg, const std::vector<Result>& results) {
+    std::cout << "### " << title << "\n\n";
+    std::cout << "| Model | Median | ±95% CI | CV | Min | Max | Runs | GB/s | Conns | Conn p50 | Conn max |\n";
+    std::cout << "|------:|-------:|--------:|---:|----:|----:|-----:|-----:|------:|---------:|---------:|\n";
+    for (const auto& r : results) {
+        RunStats st = run_stats(r.runs);
+        std::ostringstream gbps;
+        gbps << std::fixed << std::setprecision(2) << (double)((uint64_t)cfg.stream_mb << 20) / st.median / 1e9;
+        const Histogram& h = r.latency.total;
+        std::cout << "| " << r.model
+                  << " | " << fmt_sec(st.median)
+                  << " | " << fmt_pct(st.ci_rel())
+                  << " | " << fmt_pct(st.cv)
+                  << " | " << fmt_sec(st.min)
+                  << " | " << fmt_sec(st.max)
+                  << " | " << fmt_runs(r, st)
+                  << " | " << gbps.str()
+                  << " | " << h.count / (uint64_t)std::max(r.counted, 1) << "/" << cfg.stream_conns
+                  << " | " << fmt_us(h.percentile(50))
+                  << " | " << fmt_us(h.max)
+                  << " |\n";
+    }
+    std::cout << "\n";
+
+    print_counters_table(results);
+    print_memory_table(results);
+}
+
+// Spawn rows reuse LatencySet: `connect` is the time spent inside the spawn
+// call, `total` is spawn call to child reaped.
+static void print_spawn_table(const std::string& title, const std::vector<Result>& results) {
+    std::cout << "### " << title << "\n\n";
+    std::cout << "| Model | Median | ±95% CI | CV | Min | Max | Runs | Spawns/s | Call p50 | Call p99 | Reap p50 | Reap p99 |\n";
+    std::cout << "|------:|-------:|--------:|---:|----:|----:|-----:|---------:|---------:|---------:|---------:|---------:|\n";
+    for (const auto& r : results) {
+        const LatencySet& l = r.latency;
+        RunStats st = run_stats(r.runs);
+        std::cout << "| " << r.model
+                  << " | " << fmt_sec(st.median)
+                  << " | " << fmt_pct(st.ci_rel())
+                  << " | " << fmt_pct(st.cv)
+                  << " | " << fmt_sec(st.min)
+                  << " | " << fmt_sec(st.max)
+                  << " | " << fmt_runs(r, st)
+                  << " | " << (uint64_t)((double)l.total.count / kept_seconds(r.runs, st))
+                  << " | " << fmt_us(l.connect.percentile(50))
+                  << " | " << fmt_us(l.connect.percentile(99))
+                  << " | " << fmt_us(l.total.percentile(50))
+                  << " | " << fmt_us(l.total.percentile(99))
+                  << " |\n";
+    }
+    std::cout << "\n";
+}
+
+// Models that take a LatencySet& record per-request latency into it; warmup
+// runs record into a scratch set that is thrown away.
+template <class Fn>
+static void run_once(Fn& fn, LatencySet& lat) {
+    if constexpr (std::is_invocable_v<Fn&, LatencySet&>) fn(lat);
+    else fn();
+}
+
+static Result make_result(const Config& cfg, const std::string& label) {
+    Result r;
+    r.model = label;
+    r.tasks = cfg.tasks;
+    r.memory.inflight = std::max(1, std::min(cfg.concurrency, cfg.tasks));
+    r.runs.reserve(cfg.repeats);
+    return r;
+}
+
+// One timed run: the wall time goes into r.runs, its latency, counters and
+// memory into a sample of their own until count_kept_runs().
+template <class Fn>
+static void timed_run(Fn& fn, Result& r) {
+    auto sample = std::make_shared<RunSample>();
+    reset_peak_rss();
+    g_child_peak_kb = 0;
+    int64_t rss0 = current_rss_kb();
+    Counters c0 = g_counters.sample();
+    double t0 = seconds_now();
+    run_once(fn, sample->latency);
+    r.runs.push_back(seconds_now() - t0);
+    sample->counters = CounterSampler::delta(c0, g_counters.sample());
+
+    int64_t peak = peak_rss_kb();
+    sample->memory.peak_kb = peak;
+    if (peak >= 0 && rss0 >= 0) sample->memory.growth_kb = peak - rss0;
+    sample->memory.child_kb = g_child_peak_kb;
+    r.samples.push_back(std::move(sample));
+}
+
+// Folds the timed runs run_stats keeps into r's latency, counters and
+// memory, so every aggregate covers the same runs as the median.
+static void count_kept_runs(Result& r) {
+    RunStats st = run_stats(r.runs);
+    for (size_t i = 0; i < r.samples.size(); i++) {
+        if (r.runs[i] < st.fence_lo || r.runs[i] > st.fence_hi) continue;
+        const RunSample& s = *r.samples[i];
+        r.latency.merge(s.latency);
+        if (r.counted == 0) r.counters = s.counters;
+        else r.counters.add(s.counters);
+        r.memory.peak_kb = std::max(r.memory.peak_kb, s.memory.peak_kb);
+        r.memory.growth_kb = std::max(r.memory.growth_kb, s.memory.growth_kb);
+        r.memory.child_kb = std::max(r.memory.child_kb, s.memory.child_kb);
+        r.counted++;
+    }
+    r.samples.clear();
+}
+
+// Untimed runs before a model's timed ones. --warmup auto keeps going until
+// the last three agree within 10% (range over median), capped at 20 runs or
+// a quarter of --time-budget-s; returns the count, or -1 for a fixed warmup.
+template <class Fn>
+static int warm_up(const Config& cfg, Fn& fn, LatencySet& scratch) {
+    if (cfg.warmup >= 0) {
+        for (int i = 0; i < cfg.warmup; i++) run_once(fn, scratch);
+        return -1;
+    }
+    std::vector<double> t;
+    double spent = 0;
+    while (t.size() < 20) {
+        double t0 = seconds_now();
+        run_once(fn, scratch);
+        t.push_back(seconds_now() - t0);
+        spent += t.back();
+        if (t.size() >= 3) {
+            std::vector<double> last(t.end() - 3, t.end());
+            if ((maxv(last) - minv(last)) <= 0.10 * median(last)) break;
+        }
+        if (cfg.time_budget_s > 0 && spent >= cfg.time_budget_s / 4) break;
+    }
+    return (int)t.size();
+}
+
+// Fixed mode: exactly --repeats runs. With --target-ci: at least --repeats,
+// then until the median's CI is narrow enough, --max-repeats is reached or
+// the model has used --time-budget-s.
+static bool done_repeating(const Config& cfg, const Result& r) {
+    int n = (int)r.runs.size();
+    if (n < cfg.repeats) return false;
+    if (cfg.target_ci <= 0 || n >= cfg.max_repeats) return true;
+    double spent = 0;
+    for (double t : r.runs) spent += t;
+    if (cfg.time_budget_s > 0 && spent >= cfg.time_budget_s) return true;
+    RunStats st = run_stats(r.runs);
+    return st.kept >= cfg.repeats && st.ci_rel() * 100 <= cfg.target_ci;
+}
+
+// Set by --join: blocks until every client of the coordinator is about to
+// start the same timed run, so run i overlaps across the fleet.
+static void (*g_before_run)() = nullptr;
+
+template <class Fn>
+static Result run_repeated(const Config& cfg, const std::string& label, Fn fn) {
+    auto scratch = std::make_unique<LatencySet>();
+    Result r = make_result(cfg, label);
+    r.warmups = warm_up(cfg, fn, *scratch);
+    while (!done_repeating(cfg, r)) {
+        if (g_before_run) g_before_run();
+        timed_run(fn, r);
+    }
+    count_kept_runs(r);
+    return r;
+}
+
+using ModelFn = std::function<void(LatencySet&)>;
+
+// ---- Result sinks: --json, --csv and --compare ----
+//
+// Every suite that prints a result table is also recorded here under a
+// stable key ("cpu", "io", "open_loop", "spawn", ...), so the files written
+// at exit hold the same rows as the Markdown, plus every raw run.
+
+struct SuiteRecord {
+    std::string key;
+    std::string title;
+    std::vector<Result> results;
+};
+
+static std::vector<SuiteRecord> g_report;
+
+static void record_suite(const std::string& key, const std::string& title, const std::vector<Result>& results) {
+    g_report.push_back({key, title, results});
+}
+
+static std::string json_str(const std::string& s) {
+    std::ostringstream oss;
+    oss << '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') oss << '\\' << c;
+        else if (c < 0x20) oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+        else oss << c;
+    }
+    oss << '"';
+    return oss.str();
+}
+
+static std::string json_num(double v) {
+    if (!std::isfinite(v)) return "null";
+    std::ostringstream oss;
+    oss << std::setprecision(9) << v;
+    return oss.str();
+}
+
+static std::string host_cpu_model() {
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.rfind("model name", 0) == 0 && line.find(':') != std::string::npos) {
+            return line.substr(line.find(':') + 2);
+        }
+    }
+    return "";
+}
+
+static void write_histogram_json(std::ostream& out, const char* name, const Histogram& h) {
+    out << json_str(name) << ": {\"count\": " << h.count
+        << ", \"p50_ns\": " << h.percentile(50)
+        << ", \"p90_ns\": " << h.percentile(90)
+        << ", \"p99_ns\": " << h.percentile(99)
+        << ", \"p999_ns\": " << h.percentile(99.9)
+        << ", \"max_ns\": " << h.max << "}";
+}
+
+// The options a run was made with, as one JSON object: stored in --json
+// reports and checked against the baseline by --compare.
+static std::string config_json(const Config& cfg) {
+    std::ostringstream out;
+    out << "{\"tasks\": " << cfg.tasks << ", \"concurrency\": " << cfg.concurrency
+        << ", \"grain\": " << cfg.grain << ", \"repeats\": " << cfg.repeats << ", \"warmup\": " << cfg.warmup
+        << ", \"target_ci\": " << json_num(cfg.target_ci) << ", \"cpu_units\": " << cfg.cpu_units
+        << ", \"payload_size\": " << cfg.payload_size << ", \"requests_per_conn\": " << cfg.requests_per_conn
+        << ", \"pipeline_depth\": " << cfg.pipeline_depth << ", \"rate\": " << cfg.rate
+        << ", \"quantum_us\": " << cfg.quantum_us
+        << ", \"arrival\": " << json_str(cfg.arrival) << ", \"loop\": " << json_str(cfg.loop)
+        << ", \"arm\": " << json_str(cfg.arm) << ", \"transport\": " << json_str(cfg.transport)
+        << ", \"nodelay\": " << (cfg.nodelay ? "true" : "false") << ", \"server\": " << json_str(cfg.server)
+        << ", \"echo\": " << json_str(cfg.echo) << ", \"echo_buf_kb\": " << cfg.echo_buf_kb
+        << ", \"stream_mb\": " << cfg.stream_mb << ", \"stream_conns\": " << cfg.stream_conns
+        << ", \"stream_chunk_kb\": " << cfg.stream_chunk_kb << ", \"server_cpu_units\": " << cfg.server_cpu_units
+        << ", \"server_compute\": " << json_str(cfg.server_compute)
+        << ", \"kernel\": " << json_str(cfg.kernel) << ", \"pin\": " << json_str(cfg.pin)
+        << ", \"numa\": " << json_str(cfg.numa) << "}";
+    return out.str();
+}
+
+static bool write_json(const Config& cfg, const std::string& command, const std::string& path) {
+    std::ofstream out(path);
+    if (!out) return false;
+    struct utsname un {};
+    uname(&un);
+    char host[256] = {};
+    gethostname(host, sizeof(host) - 1);
+
+    out << "{\n  \"version\": 1,\n  \"command\": " << json_str(command) << ",\n  \"timestamp\": " << (long long)time(nullptr)
+        << ",\n  \"host\": {\"hostname\": " << json_str(host) << ", \"os\": " << json_str(un.sysname)
+        << ", \"release\": " << json_str(un.release) << ", \"machine\": " << json_str(un.machine)
+        << ", \"cpus\": " << std::thread::hardware_concurrency() << ", \"cpu_model\": " << json_str(host_cpu_model())
+        << "},\n";
+    out << "  \"config\": " << config_json(cfg) << ",\n";
+    out << "  \"suites\": [";
+    for (size_t s = 0; s < g_report.size(); s++) {
+        const SuiteRecord& suite = g_report[s];
+        out << (s ? "," : "") << "\n    {\"key\": " << json_str(suite.key) << ", \"title\": " << json_str(suite.title)
+            << ", \"models\": [";
+        for (size_t m = 0; m < suite.results.size(); m++) {
+            const Result& r = suite.results[m];
+            RunStats st = run_stats(r.runs);
+            out << (m ? "," : "") << "\n      {\"model\": " << json_str(r.model) << ", \"tasks\": " << r.tasks
+                << ", \"warmups\": " << r.warmups << ", \"pipeline_depth\": "
+                << (effective_depth(cfg, r) < 0 ? "null" : std::to_string(effective_depth(cfg, r)))
+                << ",\n       \"runs_s\": [";
+            for (size_t i = 0; i < r.runs.size(); i++) out << (i ? ", " : "") << json_num(r.runs[i]);
+            out << "],\n       \"median_s\": " << json_num(st.median) << ", \"ci_lo_s\": " << json_num(st.ci_lo)
+                << ", \"ci_hi_s\": " << json_num(st.ci_hi) << ", \"cv\": " << json_num(st.cv)
+                << ", \"outliers\": " << st.outliers << ", \"counted_runs\": " << r.counted
+                << ",\n       \"latency\": {";
+            const LatencySet& l = r.latency;
+            write_histogram_json(out, "connect", l.connect);
+            out << ", ";
+            write_histogram_json(out, "first_byte", l.first_byte);
+            out << ", ";
+            write_histogram_json(out, "total", l.total);
+            out << ", ";
+            write_histogram_json(out, "start_lag", l.start_lag);
+            out << ", ";
+            write_histogram_json(out, "turnaround", l.turnaround);
+            out << ", \"late\": " << l.late << ", \"dropped\": " << l.dropped << ", \"yields\": " << l.yields
+                << ", \"sched_ns\": " << l.sched_ns << ", \"capped_depth\": " << l.capped_depth << "},\n";
+            // Counter totals over the counted runs; -1 where unavailable.
+            const Counters& c = r.counters;
+            out << "       \"counters\": {\"cycles\": " << c.cycles << ", \"instructions\": " << c.instructions
+                << ", \"cache_misses\": " << c.cache_misses << ", \"ctx_switches\": " << c.ctx_switches
+                << ", \"voluntary\": " << c.voluntary << ", \"involuntary\": " << c.involuntary
+                << ", \"minor_faults\": " << c.minor_faults << ", \"loop_ctl\": " << c.loop_ctl
+                << ", \"loop_wait\": " << c.loop_wait << ", \"user_s\": " << json_num(c.user_s)
+                << ", \"sys_s\": " << json_num(c.sys_s) << "},\n";
+            const MemoryUsage& mu = r.memory;
+            out << "       \"memory\": {\"peak_kb\": " << mu.peak_kb << ", \"growth_kb\": " << mu.growth_kb
+                << ", \"child_kb\": " << mu.child_kb << ", \"per_task_kb\": " << json_num(mu.per_task_kb()) << "}}";
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+    return (bool)out;
+}
+
+static std::string csv_field(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string q = "\"";
+    for (char c : s) q += c == '"' ? std::string("\"\"") : std::string(1, c);
+    return q + "\"";
+}
+
+// One row per raw run; the model-level columns repeat on each of its rows.
+// The scheduler columns are only filled for rows that record turnaround.
+static bool write_csv(const Config& cfg, const std::string& path) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "suite,model,run,seconds,outlier,tasks,median_s,ci_lo_s,ci_hi_s,cv,p50_ns,p99_ns,p999_ns,"
+           "cycles_per_task,ctx_switches_per_task,peak_rss_kb,turnaround_p50_ns,turnaround_p99_ns,yields_per_task,"
+           "sched_ns_per_switch,pipeline_depth\n";
+    for (const auto& suite : g_report) {
+        for (const auto& r : suite.results) {
+            RunStats st = run_stats(r.runs);
+            const Histogram& h = r.latency.total;
+            double n = (double)std::max(1, r.counted) * std::max(1, r.tasks);
+            // A counter that could not be read is -1; leave its field empty.
+            auto per_task = [n](int64_t v) { return v < 0 ? std::string() : json_num((double)v / n); };
+            const LatencySet& l = r.latency;
+            std::string sched = ",,,";
+            if (l.turnaround.count > 0) {
+                const double done = (double)l.turnaround.count;
+                sched = std::to_string(l.turnaround.percentile(50)) + "," + std::to_string(l.turnaround.percentile(99)) +
+                        "," + json_num((double)l.yields / done) + "," +
+                        json_num((double)l.sched_ns / ((double)l.yields + done));
+            }
+            const int64_t depth = effective_depth(cfg, r);
+            for (size_t i = 0; i < r.runs.size(); i++) {
+                bool outlier = r.runs[i] < st.fence_lo || r.runs[i] > st.fence_hi;
+                out << csv_field(suite.key) << "," << csv_field(r.model) << "," << i << "," << json_num(r.runs[i])
+                    << "," << (outlier ? 1 : 0) << "," << r.tasks << "," << json_num(st.median) << ","
+                    << json_num(st.ci_lo) << "," << json_num(st.ci_hi) << "," << json_num(st.cv) << ","
+                    << h.percentile(50) << "," << h.percentile(99) << "," << h.percentile(99.9) << ","
+                    << per_task(r.counters.cycles) << "," << per_task(r.counters.ctx_switches) << ","
+                    << (r.memory.peak_kb < 0 ? "" : std::to_string(r.memory.peak_kb)) << "," << sched << ","
+                    << (depth < 0 ? "" : std::to_string(depth)) << "\n";
+            }
+        }
+    }
+    return (bool)out;
+}
+
+// Just enough JSON to read back what write_json produced.
+struct Json {
+    enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+    double num = 0;
+    std::string str;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> fields;
+
+    const Json* get(const std::string& key) const {
+        for (const auto& f : fields) {
+            if (f.first == key) return &f.second;
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : p_(text.c_str()), end_(text.c_str() + text.size()) {}
+
+    bool parse(Json& out) {
+        out = value();
+        skip_ws();
+        return ok_ && p_ == end_;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+    bool ok_ = true;
+
+    void skip_ws() {
+        while (p_ < end_ && std::isspace((unsigned char)*p_)) p_++;
+    }
+
+    bool eat(char c) {
+        skip_ws();
+        if (p_ < end_ && *p_ == c) {
+            p_++;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(const char* word) {
+        size_t n = std::strlen(word);
+        if ((size_t)(end_ - p_) < n || std::strncmp(p_, word, n) != 0) return false;
+        p_ += n;
+        return true;
+    }
+
+    std::string string_body() {
+        std::string s;
+        while (p_ < end_ && *p_ != '"') {
+            char c = *p_++;
+            if (c == '\\' && p_ < end_) {
+                char e = *p_++;
+                if (e == 'n') s += '\n';
+                else if (e == 't') s += '\t';
+                else if (e == 'u' && end_ - p_ >= 4) {
+                    s += (char)std::strtol(std::string(p_, 4).c_str(), nullptr, 16);
+                    p_ += 4;
+                } else s += e;
+            } else {
+                s += c;
+            }
+        }
+        if (p_ == end_) ok_ = false;
+        else p_++;
+        return s;
+    }
+
+    Json value() {
+        Json v;
+        skip_ws();
+        if (!ok_ || p_ == end_) {
+            ok_ = false;
+            return v;
+        }
+        if (eat('{')) {
+            v.type = Json::Object;
+            if (eat('}')) return v;
+            do {
+                if (!eat('"')) {
+                    ok_ = false;
+                    return v;
+                }
+                std::string key = string_body();
+                if (!eat(':')) {
+                    ok_ = false;
+                    return v;
+                }
+                v.fields.emplace_back(key, value());
+            } while (ok_ && eat(','));
+            if (!eat('}')) ok_ = false;
+        } else if (eat('[')) {
+            v.type = Json::Array;
+            if (eat(']')) return v;
+            do v.items.push_back(value());
+            while (ok_ && eat(','));
+            if (!eat(']')) ok_ = false;
+        } else if (eat('"')) {
+            v.type = Json::String;
+            v.str = string_body();
+        } else if (literal("true")) {
+            v.type = Json::Bool;
+            v.num = 1;
+        } else if (literal("false")) {
+            v.type = Json::Bool;
+        } else if (literal("null")) {
+            v.type = Json::Null;
+        } else {
+            char* end = nullptr;
+            v.type = Json::Number;
+            v.num = std::strtod(p_, &end);
+            if (end == p_) ok_ = false;
+            p_ = end;
+        }
+        return v;
+    }
+};
+
+// One-sided Mann-Whitney U test: the p-value for "b's runs are slower than
+// a's", normal approximation with tie and continuity corrections.
+static double mann_whitney_slower(const std::vector<double>& a, const std::vector<double>& b) {
+    std::vector<std::pair<double, int>> all;
+    for (double x : a) all.push_back({x, 0});
+    for (double x : b) all.push_back({x, 1});
+    std::sort(all.begin(), all.end());
+    const double n1 = (double)a.size(), n2 = (double)b.size(), n = n1 + n2;
+    double rank_b = 0, ties = 0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first) j++;
+        double avg = (double)(i + j + 1) / 2; // ranks i+1..j
+        for (size_t k = i; k < j; k++) {
+            if (all[k].second) rank_b += avg;
+        }
+        double t = (double)(j - i);
+        ties += t * t * t - t;
+        i = j;
+    }
+    double u = rank_b - n2 * (n2 + 1) / 2;
+    double var = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+    if (var <= 0) return 1;
+    double z = (u - n1 * n2 / 2 - 0.5) / std::sqrt(var);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+// --compare: matches suites and models by name against a --json file from
+// an earlier run. A model regresses when its median run is more than
+// --regress-pct slower and the U test says so at p < 0.05. Returns the
+// number of regressions, or -1 if the baseline can't be read.
+static int compare_with_baseline(const Config& cfg) {
+    std::ifstream in(cfg.compare);
+    std::stringstream text;
+    text << in.rdbuf();
+    Json base;
+    if (!in || !JsonParser(text.str()).parse(base) || !base.get("suites")) {
+        std::cerr << "Cannot read baseline " << cfg.compare << "\n";
+        return -1;
+    }
+
+    // A baseline made with a different workload is not comparable: its timings
+    // would read as regressions or speed-ups that no code change caused. The
+    // repeat and warm-up settings only decide how many runs there are, so they
+    // may differ; keys an older baseline does not have are skipped.
+    if (const Json* was_cfg = base.get("config")) {
+        Json now_cfg;
+        JsonParser(config_json(cfg)).parse(now_cfg);
+        auto show = [](const Json& v) {
+            if (v.type == Json::String) return v.str;
+            if (v.type == Json::Bool) return std::string(v.num ? "true" : "false");
+            std::ostringstream o;
+            o << v.num;
+            return o.str();
+        };
+        std::string differs;
+        for (const auto& [key, now] : now_cfg.fields) {
+            if (key == "repeats" || key == "warmup" || key == "target_ci") continue;
+            const Json* was = was_cfg->get(key);
+            if (!was || show(*was) == show(now)) continue;
+            differs += "\n  " + key + ": " + show(*was) + " in the baseline, " + show(now) + " now";
+        }
+        if (!differs.empty()) {
+            std::cerr << "Cannot compare with " << cfg.compare << ", its configuration differs:" << differs << "\n";
+            return -1;
+        }
+    }
+
+    int regressions = 0;
+    std::cout << "### Comparison with " << cfg.compare << " (regression: >" << cfg.regress_pct
+              << "% slower, p < 0.05)\n\n";
+    std::cout << "| Suite | Model | Baseline | Current | Change | p (slower) | Verdict |\n";
+    std::cout << "|------:|------:|---------:|--------:|-------:|-----------:|--------:|\n";
+    for (const auto& suite : g_report) {
+        const Json* bsuite = nullptr;
+        for (const auto& s : base.get("suites")->items) {
+            const Json* key = s.get("key");
+            if (key && key->str == suite.key) bsuite = &s;
+        }
+        for (const auto& r : suite.results) {
+            const Json* bmodel = nullptr;
+            if (bsuite && bsuite->get("models")) {
+                for (const auto& m : bsuite->get("models")->items) {
+                    const Json* name = m.get("model");
+                    if (name && name->str == r.model) bmodel = &m;
+                }
+            }
+            std::vector<double> old_runs;
+            if (bmodel && bmodel->get("runs_s")) {
+                for (const auto& x : bmodel->get("runs_s")->items) old_runs.push_back(x.num);
+            }
+            std::cout << "| " << suite.key << " | " << r.model;
+            if (old_runs.empty() || r.runs.empty()) {
+                std::cout << " | - | " << fmt_sec(run_stats(r.runs).median) << " | - | - | not in baseline |\n";
+                continue;
+            }
+            double was = run_stats(old_runs).median;
+            double now = run_stats(r.runs).median;
+            double change = now / was - 1;
+            double p_slower = mann_whitney_slower(old_runs, r.runs);
+            double p_faster = mann_whitney_slower(r.runs, old_runs);
+            const Json* tasks = bmodel->get("tasks");
+            std::string verdict = "ok";
+            if (tasks && (int)tasks->num != r.tasks) verdict = "tasks differ";
+            else if (change * 100 > cfg.regress_pct && p_slower < 0.05) verdict = "**regression**";
+            else if (-change * 100 > cfg.regress_pct && p_faster < 0.05) verdict = "faster";
+            if (verdict == "**regression**") regressions++;
+            std::ostringstream pct, p;
+            pct << std::showpos << std::fixed << std::setprecision(1) << change * 100 << "%";
+            p << std::fixed << std::setprecision(3) << p_slower;
+            std::cout << " | " << fmt_sec(was) << " | " << fmt_sec(now) << " | " << pct.str() << " | " << p.str()
+                      << " | " << verdict << " |\n";
+        }
+    }
+    std::cout << "\n";
+    return regressions;
+}
+
+// Writes --json/--csv and runs --compare; the exit status for main.
+static int finish_report(const Config& cfg, const std::string& command) {
+    if (!cfg.json.empty() && !write_json(cfg, command, cfg.json)) {
+        std::cerr << "Failed to write " << cfg.json << "\n";
+        return 1;
+    }
+    if (!cfg.csv.empty() && !write_csv(cfg, cfg.csv)) {
+        std::cerr << "Failed to write " << cfg.csv << "\n";
+        return 1;
+    }
+    if (cfg.compare.empty()) return 0;
+    int regressions = compare_with_baseline(cfg);
+    if (regressions < 0) return 1;
+    if (regressions > 0) std::cerr << regressions << " regression(s) against " << cfg.compare << "\n";
+    return regressions > 0 ? 2 : 0;
+}
+
+static uint32_t cpu_work(int units) {
+    uint32_t acc = 0;
+    for (int i = 0; i < units; i++) {
+        acc = acc * 1664525u + 1013904223u + (uint32_t)i;
+    }
+    return acc;
+}
+
+// The simd kernel runs the same LCG step over kLanes independent chains:
+// iteration i updates lane i % kLanes, so the work per task is identical but
+// throughput-bound instead of latency-bound. Every implementation below
+// produces the same lane state, hence the same checksum.
+constexpr int kLanes = 16;
+
+static void lanes_scalar(uint32_t* acc, uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+        uint32_t& a = acc[i % kLanes];
+        a = a * 1664525u + 1013904223u + i;
+    }
+}
+
+// Vector bodies handle whole rows of kLanes starting at a multiple of kLanes;
+// lanes_split() peels the unaligned head and tail off to lanes_scalar.
+template <class Body>
+static void lanes_split(uint32_t* acc, uint32_t begin, uint32_t end, Body body) {
+    uint32_t head = std::min(end, (begin + kLanes - 1) / kLanes * kLanes);
+    lanes_scalar(acc, begin, head);
+    uint32_t rows_end = head + (end - head) / kLanes * kLanes;
+    if (rows_end > head) body(head, rows_end);
+    lanes_scalar(acc, rows_end, end);
+}
+
+#if defined(BENCH_X86_SIMD)
+__attribute__((target("avx2"))) static void lanes_avx2(uint32_t* acc, uint32_t begin, uint32_t end) {
+    lanes_split(acc, begin, end, [acc](uint32_t from, uint32_t to) __attribute__((target("avx2"))) {
+        const __m256i mul = _mm256_set1_epi32((int)1664525u);
+        const __m256i add = _mm256_set1_epi32((int)1013904223u);
+        const __m256i step = _mm256_set1_epi32(kLanes);
+        __m256i a0 = _mm256_loadu_si256((const __m256i*)acc);
+        __m256i a1 = _mm256_loadu_si256((const __m256i*)(acc + 8));
+        __m256i i0 = _mm256_add_epi32(_mm256_set1_epi32((int)from), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256i i1 = _mm256_add_epi32(i0, _mm256_set1_epi32(8));
+        for (uint32_t i = from; i < to; i += kLanes) {
+            a0 = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(a0, mul), add), i0);
+            a1 = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(a1, mul), add), i1);
+            i0 = _mm256_add_epi32(i0, step);
+            i1 = _mm256_add_epi32(i1, step);
+        }
+        _mm256_storeu_si256((__m256i*)acc, a0);
+        _mm256_storeu_si256((__m256i*)(acc + 8), a1);
+    });
+}
+
+__attribute__((target("avx512f"))) static void lanes_avx512(uint32_t* acc, uint32_t begin, uint32_t end) {
+    lanes_split(acc, begin, end, [acc](uint32_t from, uint32_t to) __attribute__((target("avx512f"))) {
+        const __m512i mul = _mm512_set1_epi32((int)1664525u);
+        const __m512i add = _mm512_set1_epi32((int)1013904223u);
+        const __m512i step = _mm512_set1_epi32(kLanes);
+        __m512i a = _mm512_loadu_si512(acc);
+        __m512i idx = _mm512_add_epi32(_mm512_set1_epi32((int)from),
+                                       _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+        for (uint32_t i = from; i < to; i += kLanes) {
+            a = _mm512_add_epi32(_mm512_add_epi32(_mm512_mullo_epi32(a, mul), add), idx);
+            idx = _mm512_add_epi32(idx, step);
+        }
+        _mm512_storeu_si512(acc, a);
+    });
+}
+#elif defined(__ARM_NEON)
+static void lanes_neon(uint32_t* acc, uint32_t begin, uint32_t end) {
+    lanes_split(acc, begin, end, [acc](uint32_t from, uint32_t to) {
+        const uint32x4_t add = vdupq_n_u32(1013904223u);
+        const uint32x4_t step = vdupq_n_u32(kLanes);
+        const uint32_t base[4] = {0, 1, 2, 3};
+        uint32x4_t a[4], idx[4];
+        for (int v = 0; v < 4; v++) {
+            a[v] = vld1q_u32(acc + 4 * v);
+            idx[v] = vaddq_u32(vdupq_n_u32(from + 4 * v), vld1q_u32(base));
+        }
+        for (uint32_t i = from; i < to; i += kLanes) {
+            for (int v = 0; v < 4; v++) {
+                a[v] = vmlaq_n_u32(vaddq_u32(add, idx[v]), a[v], 1664525u);
+                idx[v] = vaddq_u32(idx[v], step);
+            }
+        }
+        for (int v = 0; v < 4; v++) vst1q_u32(acc + 4 * v, a[v]);
+    });
+}
+#endif
+
+using LanesFn = void (*)(uint32_t*, uint32_t, uint32_t);
+
+struct LanesImpl {
+    LanesFn fn;
+    const char* name;
+};
+
+static LanesImpl pick_lanes() {
+#if defined(BENCH_X86_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return {lanes_avx512, "avx512"};
+    if (__builtin_cpu_supports("avx2")) return {lanes_avx2, "avx2"};
+#elif defined(__ARM_NEON)
+    return {lanes_neon, "neon"};
+#endif
+    return {lanes_scalar, "scalar"};
+}
+
+static const LanesImpl g_lanes = pick_lanes();
+
+static uint32_t fold_lanes(const uint32_t* acc) {
+    uint32_t x = 0;
+    for (int k = 0; k < kLanes; k++) x ^= acc[k];
+    return x;
+}
+
+static uint32_t cpu_work_simd(int units) {
+    uint32_t acc[kLanes] = {};
+    g_lanes.fn(acc, 0, (uint32_t)units);
+    return fold_lanes(acc);
+}
+
+static uint32_t cpu_kernel(const Config& cfg) {
+    return cfg.kernel == "simd" ? cpu_work_simd(cfg.cpu_units) : cpu_work(cfg.cpu_units);
+}
+
+// Bounded lock-free MPMC queue (Vyukov's sequence-numbered ring). Storage is
+// inline and the atomics are address-free, so a queue constructed in
+// MAP_SHARED memory also works between forked processes.
+template <class T, size_t N>
+class MpmcQueue {
+    static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+    MpmcQueue() {
+        for (size_t i = 0; i < N; i++) cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool try_push(const T& v) {
+        size_t pos = enq_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& c = cells_[pos & (N - 1)];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (enq_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.data = v;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = enq_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& out) {
+        size_t pos = deq_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& c = cells_[pos & (N - 1)];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (deq_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = c.data;
+                    c.seq.store(pos + N, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = deq_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    Cell cells_[N];
+    alignas(64) std::atomic<size_t> enq_{0};
+    alignas(64) std::atomic<size_t> deq_{0};
+};
+
+// Long-lived worker pool for the "pool" models. It is created once in main,
+// outside run_repeated's timed region, so those rows measure the cost of
+// threads existing rather than the cost of creating them. Idle workers sleep
+// on a semaphore that counts queued jobs.
+class ThreadPool {
+public:
+    ThreadPool(const Config& cfg, int n) {
+        threads_.reserve((size_t)n);
+        for (int i = 0; i < n; i++) {
+            threads_.emplace_back([this, &cfg, i] {
+                pin_client(cfg, i);
+                work(i);
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        for (size_t i = 0; i < threads_.size(); i++) push(Job{});
+        for (auto& th : threads_) th.join();
+    }
+
+    int size() const { return (int)threads_.size(); }
+
+    // Queues fn(ctx, index, worker) and returns without waiting for it.
+    void post(void (*fn)(void*, int, int), void* ctx, int index = 0) { push(Job{fn, ctx, index}); }
+
+    // Runs f(index, worker) for every index in [0, count) and waits for all.
+    // The batch lives on the caller's stack and may be gone as soon as the
+    // last job's fetch_sub lands, so that job wakes the caller through the
+    // pool's completion counter instead of touching the batch again.
+    template <class F>
+    void run_batch(int count, F& f) {
+        struct Batch {
+            F* f;
+            ThreadPool* pool;
+            std::atomic<int> remaining;
+        };
+        Batch b{&f, this, {count}};
+        auto trampoline = [](void* ctx, int index, int worker) {
+            Batch* b = (Batch*)ctx;
+            (*b->f)(index, worker);
+            ThreadPool* pool = b->pool;
+            if (b->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                pool->batches_done_.fetch_add(1, std::memory_order_release);
+                pool->batches_done_.notify_all();
+            }
+        };
+        for (int i = 0; i < count; i++) push(Job{trampoline, &b, i});
+
+        while (true) {
+            uint64_t seen = batches_done_.load(std::memory_order_acquire);
+            if (b.remaining.load(std::memory_order_acquire) == 0) break;
+            batches_done_.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+private:
+    // fn == nullptr asks the worker to exit.
+    struct Job {
+        void (*fn)(void*, int, int) = nullptr;
+        void* ctx = nullptr;
+        int index = 0;
+    };
+
+    static constexpr int kSlots = 1024;
+
+    // A job holds one of kSlots tickets from push until it has run, so the
+    // ring never overflows and a producer facing a full ring blocks on
+    // slots_ (backpressure) instead of spinning. A running job that pushes
+    // its own continuation (the compute server's handlers hop back onto the
+    // pool) hands its ticket on rather than waiting: otherwise workers all
+    // blocked in push would be the only threads that could free a slot.
+    struct Ticket {
+        ThreadPool* pool;
+        bool held;
+    };
+    static inline thread_local Ticket t_ticket_{};
+
+    void push(const Job& j) {
+        if (t_ticket_.pool == this && t_ticket_.held) t_ticket_.held = false;
+        else slots_.acquire();
+        // Holding a ticket leaves a free cell; a failed try_push only means
+        // a popper has claimed that cell and not yet released it.
+        while (!queue_.try_push(j)) std::this_thread::yield();
+        items_.release();
+    }
+
+    void work(int id) {
+        while (true) {
+            items_.acquire();
+            Job j;
+            // A pusher that claimed an earlier cell may not have published it yet.
+            while (!queue_.try_pop(j)) std::this_thread::yield();
+            if (!j.fn) {
+                slots_.release();
+                return;
+            }
+            t_ticket_ = Ticket{this, true};
+            j.fn(j.ctx, j.index, id);
+            if (t_ticket_.held) slots_.release();
+            t_ticket_ = Ticket{};
+        }
+    }
+
+    MpmcQueue<Job, kSlots> queue_;
+    std::atomic<uint64_t> batches_done_{0};
+    std::counting_semaphore<> slots_{kSlots};
+    std::counting_semaphore<> items_{0};
+    std::vector<std::thread> threads_;
+};
+
+// Per-worker result slot, padded to its own cache line.
+struct alignas(64) WorkerResult {
+    uint32_t checksum = 0;
+};
+
+// Workers claim --grain tasks per fetch_add on a counter that sits alone on
+// its cache line, and write their checksum to a padded slot that is reduced
+// after join, so the only shared write is the claim itself.
+static void cpu_threads(const Config& cfg) {
+    alignas(64) std::atomic<int> idx{0};
+    std::vector<WorkerResult> results((size_t)cfg.concurrency);
+    std::vector<std::thread> workers;
+    workers.reserve(cfg.concurrency);
+
+    for (int t = 0; t < cfg.concurrency; t++) {
+        workers.emplace_back([&, t] {
+            pin_client(cfg, t);
+            uint32_t local = 0;
+            while (true) {
+                int begin = idx.fetch_add(cfg.grain, std::memory_order_relaxed);
+                if (begin >= cfg.tasks) break;
+                int end = std::min(begin + cfg.grain, cfg.tasks);
+                for (int i = begin; i < end; i++) local ^= cpu_kernel(cfg);
+            }
+            results[(size_t)t].checksum = local;
+        });
+    }
+    for (auto& th : workers) th.join();
+
+    uint32_t checksum = 0;
+    for (const auto& r : results) checksum ^= r.checksum;
+    (void)checksum;
+}
+
+static void cpu_pool(const Config& cfg, ThreadPool& pool) {
+    std::atomic<uint32_t> checksum{0};
+    auto job = [&](int, int) {
+        checksum.fetch_xor(cpu_kernel(cfg), std::memory_order_relaxed);
+    };
+    pool.run_batch(cfg.tasks, job);
+    (void)checksum.load();
+}
+
+static void cpu_processes(const Config& cfg) {
+    int launched = 0;
+    int completed = 0;
+
+    while (completed < cfg.tasks) {
+        while (launched - completed < cfg.concurrency && launched < cfg.tasks) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                pin_client(cfg, launched);
+                (void)cpu_kernel(cfg);
+                _exit(0);
+            }
+            launched++;
+        }
+        int status = 0;
+        (void)reap_child(&status);
+        completed++;
+    }
+}
+
+// Size-class free lists for coroutine frames, used by every promise type via
+// PooledFrame. Lists are thread-local: a frame freed on another thread (a
+// stolen CpuTask) simply joins that thread's list, so no locking is needed.
+struct FramePool {
+    static constexpr size_t kGranule = 64;
+    static constexpr size_t kClasses = 128; // frames up to 8 KiB are pooled
+
+    struct Node { Node* next; };
+    Node* free_[kClasses] = {};
+
+    ~FramePool() {
+        for (Node* head : free_) {
+            while (head) {
+                Node* n = head->next;
+                ::operator delete(head);
+                head = n;
+            }
+        }
+    }
+
+    static FramePool& local() {
+        thread_local FramePool pool;
+        return pool;
+    }
+
+    static void* alloc(size_t n) {
+        size_t c = (n + kGranule - 1) / kGranule;
+        if (c >= kClasses) return ::operator new(n);
+        FramePool& p = local();
+        if (Node* head = p.free_[c]) {
+            p.free_[c] = head->next;
+            return head;
+        }
+        return ::operator new(c * kGranule);
+    }
+
+    static void free(void* ptr, size_t n) {
+        size_t c = (n + kGranule - 1) / kGranule;
+        if (c >= kClasses) { ::operator delete(ptr); return; }
+        FramePool& p = local();
+        Node* node = (Node*)ptr;
+        node->next = p.free_[c];
+        p.free_[c] = node;
+    }
+};
+
+struct PooledFrame {
+    static void* operator new(size_t n) { return FramePool::alloc(n); }
+    static void operator delete(void* p, size_t n) { FramePool::free(p, n); }
+};
+
+struct CpuTask {
+    struct promise_type : PooledFrame {
+        CpuTask get_return_object() {
+            return CpuTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> h{};
+
+    CpuTask() = default;
+    explicit CpuTask(std::coroutine_handle<promise_type> h_) : h(h_) {}
+
+    CpuTask(const CpuTask&) = delete;
+    CpuTask& operator=(const CpuTask&) = delete;
+
+    CpuTask(CpuTask&& o) noexcept : h(o.h) { o.h = {}; }
+
+    CpuTask& operator=(CpuTask&& o) noexcept {
+        if (this != &o) {
+            if (h) h.destroy();
+            h = o.h;
+            o.h = {};
+        }
+        return *this;
+    }
+
+    ~CpuTask() {
+        if (h) h.destroy();
+    }
+
+    bool done() const noexcept { return !h || h.done(); }
+    void resume() { if (h && !h.done()) h.resume(); }
+};
+
+// Cycle counter for quantum checks and scheduler accounting: rdtsc or
+// cntvct_el0, a few ns to read; steady_clock elsewhere. ticks_per_ns()
+// calibrates it against steady_clock once, over ~5 ms; main calls it before
+// any measurement.
+static inline uint64_t cycle_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return now_ns();
+#endif
+}
+
+static double ticks_per_ns() {
+    static const double ratio = [] {
+        uint64_t n0 = now_ns(), c0 = cycle_ticks();
+        while (now_ns() - n0 < 5000000) {}
+        uint64_t n1 = now_ns(), c1 = cycle_ticks();
+        return std::max((double)(c1 - c0) / (double)(n1 - n0), 1e-3);
+    }();
+    return ratio;
+}
+
+static uint64_t ticks_to_ns(uint64_t ticks) {
+    return (uint64_t)((double)ticks / ticks_per_ns());
+}
+
+// Units between quantum checks: enough that reading the counter costs well
+// under 1% of the work.
+constexpr int kQuantumCheck = 1024;
+
+// Yields every `chunk` units, or with a nonzero quantum (in cycle_ticks)
+// once that much time has passed since it was last resumed.
+static CpuTask cpu_coroutine_job(int units, int chunk, uint64_t quantum, bool simd, std::atomic<uint32_t>* out) {
+    uint32_t acc = 0;
+    uint32_t lanes[kLanes] = {};
+    int done = 0;
+    uint64_t slice = quantum ? cycle_ticks() : 0;
+    while (done < units) {
+        int step = std::min(quantum ? kQuantumCheck : chunk, units - done);
+        if (simd) {
+            g_lanes.fn(lanes, (uint32_t)done, (uint32_t)(done + step));
+        } else {
+            for (int i = 0; i < step; i++) {
+                acc = acc * 1664525u + 1013904223u + (uint32_t)(done + i);
+            }
+        }
+        done += step;
+        if (quantum && done < units && cycle_ticks() - slice < quantum) continue;
+        co_await std::suspend_always{}; // cooperative yield
+        if (quantum) slice = cycle_ticks();
+    }
+    out->fetch_xor(simd ? fold_lanes(lanes) : acc, std::memory_order_relaxed);
+    co_return;
+}
+
+static uint64_t quantum_ticks(const Config& cfg) {
+    return cfg.quantum_us > 0 ? (uint64_t)((double)cfg.quantum_us * 1000.0 * ticks_per_ns()) : 0;
+}
+
+// FIFO ready queue: the front task runs until it yields and goes to the
+// back; a finished one is replaced by a fresh task at the back. Entries
+// carry when they became ready, so each resume records its wait (start_lag)
+// and each task its launch-to-finish time (turnaround). Whatever time is not
+// spent inside resume() is scheduling overhead (sched_ns).
+static void cpu_coroutines(const Config& cfg, LatencySet& lat) {
+    ScopedPin pin(cfg);
+    const int chunk = 5000;
+    const uint64_t quantum = quantum_ticks(cfg);
+    const bool simd = cfg.kernel == "simd";
+    std::atomic<uint32_t> checksum{0};
+
+    struct Ready {
+        CpuTask task;
+        uint64_t born;
+        uint64_t since;
+    };
+    std::deque<Ready> ready;
+    int launched = 0;
+
+    auto launch_one = [&](uint64_t now) {
+        ready.push_back(Ready{cpu_coroutine_job(cfg.cpu_units, chunk, quantum, simd, &checksum), now, now});
+        launched++;
+    };
+
+    const uint64_t t0 = cycle_ticks();
+    while (launched < cfg.tasks && launched < cfg.concurrency) launch_one(t0);
+
+    uint64_t in_tasks = 0;
+    while (!ready.empty()) {
+        Ready r = std::move(ready.front());
+        ready.pop_front();
+        uint64_t before = cycle_ticks();
+        lat.start_lag.record(ticks_to_ns(before - r.since));
+        r.task.resume();
+        uint64_t after = cycle_ticks();
+        in_tasks += after - before;
+        if (r.task.done()) {
+            lat.turnaround.record(ticks_to_ns(after - r.born));
+            if (launched < cfg.tasks) launch_one(after);
+        } else {
+            lat.yields++;
+            r.since = after;
+            ready.push_back(std::move(r));
+        }
+    }
+    lat.sched_ns += ticks_to_ns(cycle_ticks() - t0 - in_tasks);
+
+    (void)checksum.load();
+}
+
+// Per-worker run queue for the M:N scheduler. The owner takes from the front
+// and re-queues yielded tasks at the back, so it round-robins like
+// cpu_coroutines; thieves take from the back.
+struct alignas(64) WsDeque {
+    std::mutex m;
+    std::deque<CpuTask> q;
+
+    void push(CpuTask t) {
+        std::lock_guard<std::mutex> lk(m);
+        q.push_back(std::move(t));
+    }
+    bool pop(CpuTask& out) {
+        std::lock_guard<std::mutex> lk(m);
+        if (q.empty()) return false;
+        out = std::move(q.front());
+        q.pop_front();
+        return true;
+    }
+    bool steal(CpuTask& out) {
+        std::lock_guard<std::mutex> lk(m);
+        if (q.empty()) return false;
+        out = std::move(q.back());
+        q.pop_back();
+        return true;
+    }
+};
+
+static void cpu_coroutines_mt(const Config& cfg) {
+    const int chunk = 5000;
+    const uint64_t quantum = quantum_ticks(cfg);
+    std::atomic<uint32_t> checksum{0};
+
+    int nworkers = cfg.workers;
+    if (nworkers < 1) nworkers = (int)std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<WsDeque> queues((size_t)nworkers);
+    std::atomic<int> launched{0};
+    std::atomic<int> finished{0};
+
+    // Seed `concurrency` tasks round-robin; every completion launches a
+    // replacement on the worker that finished it.
+    auto try_launch = [&](WsDeque& q) {
+        if (launched.fetch_add(1, std::memory_order_relaxed) >= cfg.tasks) return;
+        q.push(cpu_coroutine_job(cfg.cpu_units, chunk, quantum, cfg.kernel == "simd", &checksum));
+    };
+    for (int i = 0; i < std::min(cfg.concurrency, cfg.tasks); i++) try_launch(queues[(size_t)(i % nworkers)]);
+
+    std::vector<std::thread> workers;
+    workers.reserve((size_t)nworkers);
+    for (int w = 0; w < nworkers; w++) {
+        workers.emplace_back([&, w] {
+            pin_client(cfg, w);
+            WsDeque& own = queues[(size_t)w];
+            uint32_t victim = (uint32_t)w;
+            CpuTask t;
+            while (finished.load(std::memory_order_acquire) < cfg.tasks) {
+                bool got = own.pop(t);
+                for (int k = 1; !got && k < nworkers; k++) {
+                    victim = victim * 1664525u + 1013904223u;
+                    got = queues[victim % (uint32_t)nworkers].steal(t);
+                }
+                if (!got) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                t.resume();
+                if (t.done()) {
+                    t = CpuTask{};
+                    finished.fetch_add(1, std::memory_order_release);
+                    try_launch(own);
+                } else {
+                    own.push(std::move(t));
+                }
+            }
+        });
+    }
+    for (auto& th : workers) th.join();
+    (void)checksum.load();
+}
+
+static int set_timeouts(int fd, int timeout_ms) {
+    timeval tv{};
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) return -1;
+    if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0) return -1;
+    return 0;
+}
+
+static int set_nonblocking(int fd) {
+    int fl = fcntl(fd, F_GETFL, 0);
+    if (fl < 0) return -1;
+    if (fcntl(fd, F_SETFL, fl | O_NONBLOCK) < 0) return -1;
+    return 0;
+}
+
+// ---- Transports ----
+//
+// --transport picks how clients reach the echo server: loopback TCP over
+// IPv4 or IPv6, a Unix stream socket, or socketpair. With socketpair,
+// "connecting" makes a connected pair and passes the server's end over the
+// server's Unix datagram socket (SCM_RIGHTS), so there is no listen/accept
+// and no TCP stack at all. Endpoint is plain data, so the pre-fork pool can
+// carry it in shared memory.
+
+struct Endpoint {
+    int family = AF_INET;  // of the listener: AF_INET, AF_INET6 or AF_UNIX
+    bool pair = false;     // socketpair
+    bool nodelay = false;  // TCP_NODELAY on both ends
+    sockaddr_storage addr{};
+    socklen_t len = 0;
+};
+
+static void set_nodelay(int fd, const Endpoint& ep) {
+    if (!ep.nodelay || ep.family == AF_UNIX) return;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+static int send_fd(int via, const Endpoint& ep, int fd) {
+    char byte = 0;
+    iovec iov{&byte, 1};
+    alignas(cmsghdr) char ctl[CMSG_SPACE(sizeof(int))] = {};
+    msghdr mh{};
+    mh.msg_name = (void*)&ep.addr;
+    mh.msg_namelen = ep.len;
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctl;
+    mh.msg_controllen = sizeof(ctl);
+    cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+    ssize_t n;
+    do n = ::sendmsg(via, &mh, 0);
+    while (n < 0 && errno == EINTR);
+    return n == 1 ? 0 : -1;
+}
+
+// The fd passed by send_fd, or -1 with errno set (EAGAIN when there is none
+// yet on a non-blocking socket, EPIPE once the socket is shut down).
+static int recv_fd(int via) {
+    char byte;
+    iovec iov{&byte, 1};
+    alignas(cmsghdr) char ctl[CMSG_SPACE(sizeof(int))];
+    msghdr mh{};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctl;
+    mh.msg_controllen = sizeof(ctl);
+    ssize_t n = ::recvmsg(via, &mh, 0);
+    if (n <= 0) {
+        if (n == 0) errno = EPIPE;
+        return -1;
+    }
+    cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+    if (!cm || cm->cmsg_type != SCM_RIGHTS) {
+        errno = EINTR; // a stray datagram; try again
+        return -1;
+    }
+    int fd;
+    std::memcpy(&fd, CMSG_DATA(cm), sizeof(int));
+    return fd;
+}
+
+// Opens a client connection to ep and returns the socket, or -1. Blocking
+// sockets get timeout_ms as SO_RCVTIMEO/SO_SNDTIMEO. Non-blocking TCP
+// connects may still be in flight (*pending): wait for writability, then
+// check SO_ERROR. Unix and socketpair connects complete before this returns,
+// so a momentarily full accept backlog can't fail them with EAGAIN.
+static int transport_connect(const Endpoint& ep, bool nonblocking, int timeout_ms, bool* pending) {
+    *pending = false;
+    int s = -1;
+    if (ep.pair) {
+        // One datagram socket per thread carries every pair it makes.
+        static thread_local int via = -1;
+        if (via < 0) via = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+        int sv[2];
+        if (via < 0 || ::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) return -1;
+        int sent = send_fd(via, ep, sv[1]);
+        ::close(sv[1]);
+        if (sent < 0) {
+            ::close(sv[0]);
+            return -1;
+        }
+        s = sv[0];
+    } else {
+        s = ::socket(ep.family, SOCK_STREAM, 0);
+        if (s < 0) return -1;
+        set_nodelay(s, ep);
+        bool async = nonblocking && ep.family != AF_UNIX;
+        if ((async && set_nonblocking(s) < 0) || (!nonblocking && set_timeouts(s, timeout_ms) < 0)) {
+            ::close(s);
+            return -1;
+        }
+        if (::connect(s, (const sockaddr*)&ep.addr, ep.len) < 0) {
+            if (!async || errno != EINPROGRESS) {
+                ::close(s);
+                return -1;
+            }
+            *pending = true;
+        }
+        if (async) return s;
+    }
+    if ((nonblocking && set_nonblocking(s) < 0) || (!nonblocking && set_timeouts(s, timeout_ms) < 0)) {
+        ::close(s);
+        return -1;
+    }
+    return s;
+}
+
+static uint16_t endpoint_port(const Endpoint& ep) {
+    if (ep.family == AF_INET6) return ntohs(((const sockaddr_in6*)&ep.addr)->sin6_port);
+    if (ep.family == AF_INET) return ntohs(((const sockaddr_in*)&ep.addr)->sin_port);
+    return 0;
+}
+
+static void set_endpoint_port(Endpoint* ep, uint16_t port) {
+    if (ep->family == AF_INET6) ((sockaddr_in6*)&ep->addr)->sin6_port = htons(port);
+    else if (ep->family == AF_INET) ((sockaddr_in*)&ep->addr)->sin_port = htons(port);
+}
+
+static std::string endpoint_str(const Endpoint& ep) {
+    if (ep.family == AF_UNIX) return ((const sockaddr_un*)&ep.addr)->sun_path;
+    char buf[INET6_ADDRSTRLEN] = {};
+    const bool v6 = ep.family == AF_INET6;
+    const void* a = v6 ? (const void*)&((const sockaddr_in6*)&ep.addr)->sin6_addr
+                       : (const void*)&((const sockaddr_in*)&ep.addr)->sin_addr;
+    ::inet_ntop(ep.family, a, buf, sizeof(buf));
+    std::string port = std::to_string(endpoint_port(ep));
+    return v6 ? "[" + std::string(buf) + "]:" + port : std::string(buf) + ":" + port;
+}
+
+// "host:port" or "[v6 address]:port" as a TCP endpoint; the port defaults
+// to 0, and with `passive` an empty host is the wildcard address.
+static bool resolve_endpoint(const std::string& spec, bool passive, Endpoint* ep) {
+    std::string host = spec;
+    std::string port = "0";
+    if (!spec.empty() && spec[0] == '[') {
+        size_t close = spec.find(']');
+        if (close == std::string::npos || (close + 1 < spec.size() && spec[close + 1] != ':')) return false;
+        host = spec.substr(1, close - 1);
+        if (close + 2 < spec.size()) port = spec.substr(close + 2);
+    } else if (spec.find(':') != std::string::npos && spec.find(':') == spec.rfind(':')) {
+        host = spec.substr(0, spec.find(':'));
+        port = spec.substr(spec.find(':') + 1);
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    addrinfo* res = nullptr;
+    if (::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &res) != 0 || !res) return false;
+    *ep = Endpoint{};
+    ep->family = res->ai_family;
+    std::memcpy(&ep->addr, res->ai_addr, res->ai_addrlen);
+    ep->len = (socklen_t)res->ai_addrlen;
+    ::freeaddrinfo(res);
+    return true;
+}
+
+// The server's next client socket from a listener made by transport_listen.
+static int transport_accept(int listen_fd, const Endpoint& ep) {
+    int c = ep.pair ? recv_fd(listen_fd) : ::accept(listen_fd, nullptr, nullptr);
+    if (c >= 0) set_nodelay(c, ep);
+    return c;
+}
+
+// Binds and listens for cfg.transport. TCP listeners bind loopback, or
+// --bind, on want_port (0: --bind's port or any) and fill in the port they
+// got; Unix ones bind a fresh path under /tmp, which the caller unlinks.
+static int transport_listen(const Config& cfg, Endpoint* ep, uint16_t want_port, bool reuseport) {
+    static std::atomic<int> seq{0};
+    ep->pair = cfg.transport == "socketpair";
+    ep->nodelay = cfg.nodelay;
+    ep->family = cfg.transport == "tcp6" ? AF_INET6 : cfg.transport == "tcp" ? AF_INET : AF_UNIX;
+    std::memset(&ep->addr, 0, sizeof(ep->addr));
+
+    Endpoint bound;
+    const bool use_bind = !cfg.bind.empty() && ep->family != AF_UNIX;
+    if (use_bind) {
+        if (!resolve_endpoint(cfg.bind, true, &bound)) return -1;
+        ep->family = bound.family;
+    }
+
+    int fd = ::socket(ep->family, ep->pair ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    if (ep->family == AF_UNIX) {
+        auto* un = (sockaddr_un*)&ep->addr;
+        un->sun_family = AF_UNIX;
+        std::snprintf(un->sun_path, sizeof(un->sun_path), "/tmp/bench-%d-%d.sock", (int)::getpid(), seq++);
+        ::unlink(un->sun_path);
+        ep->len = (socklen_t)sizeof(sockaddr_un);
+    } else {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#if defined(SO_REUSEPORT)
+        if (reuseport) setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+#endif
+        if (use_bind) {
+            ep->addr = bound.addr;
+            ep->len = bound.len;
+            if (want_port) set_endpoint_port(ep, want_port);
+        } else if (ep->family == AF_INET6) {
+            auto* in6 = (sockaddr_in6*)&ep->addr;
+            in6->sin6_family = AF_INET6;
+            in6->sin6_addr = in6addr_loopback;
+            in6->sin6_port = htons(want_port);
+            ep->len = (socklen_t)sizeof(sockaddr_in6);
+        } else {
+            auto* in = (sockaddr_in*)&ep->addr;
+            in->sin_family = AF_INET;
+            in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            in->sin_port = htons(want_port);
+            ep->len = (socklen_t)sizeof(sockaddr_in);
+        }
+    }
+    (void)reuseport;
+
+    if (::bind(fd, (sockaddr*)&ep->addr, ep->len) < 0 || (!ep->pair && ::listen(fd, cfg.backlog) < 0)) {
+        ::close(fd);
+        return -1;
+    }
+    if (ep->family != AF_UNIX && ::getsockname(fd, (sockaddr*)&ep->addr, &ep->len) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void transport_unlink(const Endpoint& ep) {
+    if (ep.family == AF_UNIX) ::unlink(((const sockaddr_un*)&ep.addr)->sun_path);
+}
+
+// Wire framing for the echo clients: every message starts with its sequence
+// number and length, so echoed responses (which come back in order) can be
+// matched to their requests when several are in flight on one connection.
+// The header overwrites the first bytes of the payload, so the wire size
+// stays --payload-size (but at least one header).
+struct MsgHeader {
+    uint32_t seq;
+    uint32_t len;
+};
+
+static size_t msg_size(const Config& cfg) {
+    return std::max((size_t)cfg.payload_size, sizeof(MsgHeader));
+}
+
+// Scatter list for the unsent tail of a message starting at byte `off`:
+// the rest of the header, then the rest of the shared payload.
+static int msg_iov(iovec* iov, MsgHeader* h, const char* payload, size_t size, size_t off) {
+    int n = 0;
+    if (off < sizeof(MsgHeader)) {
+        iov[n++] = iovec{(char*)h + off, sizeof(MsgHeader) - off};
+        off = sizeof(MsgHeader);
+    }
+    if (off < size) iov[n++] = iovec{(void*)(payload + off), size - off};
+    return n;
+}
+
+// Per-connection request window: up to `depth` requests are sent before the
+// client blocks on the oldest echo. With depth 1 this is plain
+// send-then-recv. The stamps ring holds each outstanding request's start;
+// got and t_first track the echo being read by pipeline_drain.
+struct PipelineWindow {
+    int total;
+    int depth;
+    uint64_t* stamps;
+    uint32_t next_send = 0;
+    uint32_t next_recv = 0;
+    size_t got = 0;
+    uint64_t t_first = 0;
+
+    bool can_send() const { return (int)next_send < total && (int)(next_send - next_recv) < depth; }
+    bool done() const { return (int)next_recv >= total; }
+    uint64_t& stamp(uint32_t seq) { return stamps[seq % (uint32_t)depth]; }
+};
+
+// Non-blocking clients read through here: whatever echoes have arrived, up
+// to the request being sent (with `sending` its echo may already have
+// started), without waiting. Returns 1 if anything was read, 0 on EAGAIN
+// with nothing read, -1 once the connection failed or an echo came back out
+// of order.
+static int pipeline_drain(int s, char* buf, size_t size, PipelineWindow& win, bool sending, LatencySet* lat) {
+    int progress = 0;
+    while (win.next_recv < win.next_send + (sending ? 1u : 0u)) {
+        ssize_t n = ::recv(s, buf + win.got, size - win.got, 0);
+        if (n <= 0) return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ? progress : -1;
+        if (win.got == 0) win.t_first = now_ns();
+        win.got += (size_t)n;
+        progress = 1;
+        if (win.got < size) continue;
+
+        MsgHeader h;
+        std::memcpy(&h, buf, sizeof(h));
+        if (h.seq != win.next_recv) return -1;
+        uint64_t t_req = win.stamp(h.seq);
+        lat->first_byte.record(win.t_first - t_req);
+        lat->total.record(now_ns() - t_req);
+        win.next_recv++;
+        win.got = 0;
+    }
+    return progress;
+}
+
+// Arrival offsets (ns from the start of a run) for the open-loop rows: one
+// per task, either evenly spaced at --rate or with exponential gaps (a
+// Poisson process). The seed is fixed so every run and model sees the same
+// timeline.
+static std::vector<uint64_t> arrival_schedule(const Config& cfg) {
+    std::vector<uint64_t> out((size_t)cfg.tasks);
+    const double gap_ns = 1e9 / cfg.rate;
+    std::mt19937_64 rng(42);
+    std::exponential_distribution<double> exp_gap(1.0 / gap_ns);
+    double t = 0;
+    for (auto& o : out) {
+        o = (uint64_t)t;
+        t += cfg.arrival == "uniform" ? gap_ns : exp_gap(rng);
+    }
+    return out;
+}
+
+// A task that starts more than this far behind its arrival counts as late.
+constexpr uint64_t kLateNs = 1000000;
+
+// Called when an open-loop task actually starts: records how far behind
+// schedule it is and drops it once it is more than --timeout-ms late, since
+// its client would have given up by then.
+static bool open_loop_start(uint64_t due, int timeout_ms, LatencySet* lat) {
+    uint64_t now = now_ns();
+    uint64_t lag = now > due ? now - due : 0;
+    lat->start_lag.record(lag);
+    if (lag > kLateNs) lat->late++;
+    if (lag > (uint64_t)timeout_ms * 1000000) {
+        lat->dropped++;
+        return false;
+    }
+    return true;
+}
+
+// Clients that can't read while a send is stuck (blocking sockets, and the
+// io_uring client's one op at a time) need the whole window to fit in the
+// socket's buffers; otherwise client and server both block in write(). The
+// depth is capped to SO_SNDBUF + SO_RCVBUF over the message size and the cap
+// goes into lat->capped_depth, so the row reports the depth it really ran at.
+static int fitting_depth(int s, int depth, size_t size, LatencySet* lat) {
+    int snd = 0, rcv = 0;
+    socklen_t len = sizeof(int);
+    if (depth <= 1 || ::getsockopt(s, SOL_SOCKET, SO_SNDBUF, &snd, &len) < 0) return depth;
+    len = sizeof(int);
+    if (::getsockopt(s, SOL_SOCKET, SO_RCVBUF, &rcv, &len) < 0) return depth;
+    size_t fit = std::max<size_t>(1, ((size_t)snd + (size_t)rcv) / size);
+    if ((size_t)depth <= fit) return depth;
+    if (!lat->capped_depth || fit < lat->capped_depth) lat->capped_depth = fit;
+    return (int)fit;
+}
+
+// A nonzero `due` is the task's scheduled arrival, which the first request
+// is then timed from.
+static void io_one_blocking(const Config& cfg, const Endpoint& ep, LatencySet* lat, uint64_t due = 0) {
+    uint64_t t0 = now_ns();
+    const uint64_t t_start = due ? due : t0;
+    bool pending;
+    int s = transport_connect(ep, false, cfg.timeout_ms, &pending);
+    if (s < 0) return;
+    lat->connect.record(now_ns() - t0);
+
+    const size_t size = msg_size(cfg);
+    std::vector<char> payload(size, 'x');
+    std::vector<char> buf(size);
+    std::vector<uint64_t> stamps((size_t)cfg.pipeline_depth);
+    PipelineWindow win{cfg.requests_per_conn, fitting_depth(s, cfg.pipeline_depth, size, lat), stamps.data()};
+
+    while (!win.done()) {
+        while (win.can_send()) {
+            MsgHeader h{win.next_send, (uint32_t)size};
+            win.stamp(win.next_send) = win.next_send == 0 ? t_start : now_ns();
+            size_t off = 0;
+            while (off < size) {
+                iovec iov[2];
+                msghdr mh{};
+                mh.msg_iov = iov;
+                mh.msg_iovlen = msg_iov(iov, &h, payload.data(), size, off);
+                ssize_t w = ::sendmsg(s, &mh, 0);
+                if (w <= 0) { ::close(s); return; }
+                off += (size_t)w;
+            }
+            win.next_send++;
+        }
+
+        size_t got = 0;
+        uint64_t t_first = 0;
+        while (got < size) {
+            ssize_t n = ::recv(s, buf.data() + got, size - got, 0);
+            if (n <= 0) { ::close(s); return; }
+            if (got == 0) t_first = now_ns();
+            got += (size_t)n;
+        }
+
+        MsgHeader h;
+        std::memcpy(&h, buf.data(), sizeof(h));
+        if (h.seq != win.next_recv) { ::close(s); return; }
+        uint64_t t_req = win.stamp(h.seq);
+        lat->first_byte.record(t_first - t_req);
+        lat->total.record(now_ns() - t_req);
+        win.next_recv++;
+    }
+
+    ::close(s);
+}
+
+// With open_loop, task i starts at its --rate arrival time instead of as
+// soon as a worker is free; a task that finds every worker busy waits in
+// line, and that wait is part of its latency.
+static void io_threads(const Config& cfg, const Endpoint& ep, LatencySet& lat, bool open_loop = false) {
+    const std::vector<uint64_t> schedule = open_loop ? arrival_schedule(cfg) : std::vector<uint64_t>{};
+    const uint64_t base = now_ns();
+    std::atomic<int> idx{0};
+    std::mutex lat_mu;
     std::vector<std::thread> workers;
     workers.reserve(cfg.concurrency);
 
-    for (int t = 0; t < cfg.concurrency; t++) {
-        workers.emplace_back([&] {
-            while (true) {
-                int i = idx.fetch_add(1, std::memory_order_relaxed);
-                if (i >= cfg.tasks) break;
-                io_one_blocking(port, cfg.payload_size, cfg.timeout_ms);
+    for (int t = 0; t < cfg.concurrency; t++) {
+        workers.emplace_back([&, t] {
+            pin_client(cfg, t);
+            auto local = std::make_unique<LatencySet>();
+            while (true) {
+                int i = idx.fetch_add(1, std::memory_order_relaxed);
+                if (i >= cfg.tasks) break;
+                uint64_t due = 0;
+                if (open_loop) {
+                    due = base + schedule[(size_t)i];
+                    uint64_t now = now_ns();
+                    if (now < due) std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+                    if (!open_loop_start(due, cfg.timeout_ms, local.get())) continue;
+                }
+                io_one_blocking(cfg, ep, local.get(), due);
+            }
+            std::lock_guard<std::mutex> lk(lat_mu);
+            lat.merge(*local);
+        });
+    }
+    for (auto& th : workers) th.join();
+}
+
+static void io_pool(const Config& cfg, ThreadPool& pool, const Endpoint& ep, LatencySet& lat) {
+    std::vector<std::unique_ptr<LatencySet>> per_worker((size_t)pool.size());
+    for (auto& l : per_worker) l = std::make_unique<LatencySet>();
+
+    auto job = [&](int, int worker) {
+        io_one_blocking(cfg, ep, per_worker[(size_t)worker].get());
+    };
+    pool.run_batch(cfg.tasks, job);
+
+    for (auto& l : per_worker) lat.merge(*l);
+}
+
+// Cross-process wakeup word for the pre-fork pool: waiters sleep until the
+// sequence number moves or timeout_ms pass, so a peer that died without
+// notifying is noticed. A futex on Linux; elsewhere a short sleep poll.
+struct ShmEvent {
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint32_t> waiters{0};
+
+    uint32_t prepare() const { return seq.load(std::memory_order_acquire); }
+
+    // False if timeout_ms passed with the sequence number still at seen.
+    bool wait(uint32_t seen, int timeout_ms) {
+        waiters.fetch_add(1, std::memory_order_acq_rel);
+        if (seq.load(std::memory_order_acquire) == seen) {
+#if defined(__linux__)
+            timespec ts{timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000};
+            ::syscall(SYS_futex, (uint32_t*)&seq, FUTEX_WAIT, seen, &ts, nullptr, 0);
+#else
+            (void)timeout_ms;
+            ::usleep(50);
+#endif
+        }
+        waiters.fetch_sub(1, std::memory_order_acq_rel);
+        return seq.load(std::memory_order_acquire) != seen;
+    }
+
+    void notify(int n) {
+        seq.fetch_add(1, std::memory_order_acq_rel);
+#if defined(__linux__)
+        if (waiters.load(std::memory_order_acquire) > 0) {
+            ::syscall(SYS_futex, (uint32_t*)&seq, FUTEX_WAKE, n, nullptr, nullptr, 0);
+        }
+#else
+        (void)n;
+#endif
+    }
+};
+
+// `concurrency` long-lived children forked once, up front (before any other
+// threads exist), like Python's ProcessPoolExecutor. Task indices go to the
+// children and checksums come back through lock-free rings in MAP_SHARED
+// memory; I/O latency is merged into a shared LatencySet. The numeric
+// workload parameters travel with every batch, so one pool serves a whole
+// --sweep; only the child count is fixed at fork time.
+class ProcessPool {
+public:
+    enum Kind : uint32_t { kExit, kCpu, kIo };
+
+    ProcessPool(const Config& cfg, int n) {
+        void* mem = ::mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            std::perror("mmap");
+            std::exit(1);
+        }
+        sh_ = new (mem) Shared();
+
+        for (int i = 0; i < n; i++) {
+            pid_t pid = ::fork();
+            if (pid < 0) {
+                std::perror("fork");
+                std::exit(1);
+            }
+            if (pid == 0) {
+                pin_client(cfg, i);
+                child(cfg);
+            }
+            pids_.push_back(pid);
+            g_live_children.push_back(pid);
+        }
+    }
+
+    ~ProcessPool() {
+        for (size_t i = 0; i < pids_.size(); i++) {
+            while (!sh_->tasks.try_push(Job{kExit, 0})) std::this_thread::yield();
+        }
+        sh_->work.notify(INT_MAX);
+        for (pid_t pid : pids_) {
+            int status = 0;
+            (void)::waitpid(pid, &status, 0);
+            g_live_children.erase(std::remove(g_live_children.begin(), g_live_children.end(), pid),
+                                  g_live_children.end());
+        }
+        sh_->~Shared();
+        ::munmap(sh_, sizeof(Shared));
+    }
+
+    // Runs `count` jobs of `kind` with cfg's workload parameters and returns
+    // the XOR of their checksums.
+    uint32_t run_batch(const Config& cfg, Kind kind, int count, const Endpoint* ep, LatencySet* lat) {
+        if (lat) sh_->latency = LatencySet{};
+        sh_->params = Params{cfg.cpu_units, cfg.payload_size, cfg.requests_per_conn, cfg.pipeline_depth};
+        if (ep) sh_->endpoint = *ep;
+
+        uint32_t checksum = 0;
+        int submitted = 0;
+        int completed = 0;
+        uint64_t next_check = now_ns() + (uint64_t)kLivenessMs * 1000000;
+        while (completed < count) {
+            int pushed = 0;
+            while (submitted < count && sh_->tasks.try_push(Job{kind, (uint32_t)submitted})) {
+                submitted++;
+                pushed++;
+            }
+            if (pushed) sh_->work.notify(pushed);
+
+            uint32_t seen = sh_->done.prepare();
+            Done d;
+            bool any = false;
+            while (sh_->results.try_pop(d)) {
+                checksum ^= d.checksum;
+                completed++;
+                any = true;
+            }
+            if (!any && completed < count) {
+                sh_->done.wait(seen, kLivenessMs);
+                // The other children may keep finishing jobs, so a crash is
+                // looked for on a clock rather than only when results stop.
+                if (now_ns() >= next_check) {
+                    check_children();
+                    next_check = now_ns() + (uint64_t)kLivenessMs * 1000000;
+                }
+            }
+        }
+
+        if (lat) lat->merge(sh_->latency);
+        return checksum;
+    }
+
+private:
+    struct Job {
+        uint32_t kind;
+        uint32_t index;
+    };
+    struct Done {
+        uint32_t index;
+        uint32_t checksum;
+    };
+    // Published before the batch's jobs; the queue's release/acquire pairs
+    // make it visible to whichever child pops one.
+    struct Params {
+        int cpu_units;
+        int payload_size;
+        int requests_per_conn;
+        int pipeline_depth;
+    };
+    struct Shared {
+        Params params{};
+        Endpoint endpoint{};
+        MpmcQueue<Job, 1024> tasks;
+        MpmcQueue<Done, 1024> results;
+        ShmEvent work;
+        ShmEvent done;
+        LatencySet latency{};
+    };
+
+    // How often an idle waiter checks that the other side is still alive.
+    static constexpr int kLivenessMs = 200;
+
+    // A child that crashed takes its job with it, and the batch would wait
+    // for that result forever.
+    void check_children() {
+        for (pid_t pid : pids_) {
+            int status = 0;
+            if (::waitpid(pid, &status, WNOHANG) != pid) continue;
+            std::cerr << "Pre-forked child " << pid << " died ("
+                      << (WIFSIGNALED(status) ? "signal " + std::to_string(WTERMSIG(status))
+                                              : "exit " + std::to_string(WEXITSTATUS(status)))
+                      << ") with jobs outstanding\n";
+            std::exit(1);
+        }
+    }
+
+    [[noreturn]] void child(const Config& fork_cfg) {
+        Config cfg = fork_cfg;
+        auto local = std::make_unique<LatencySet>();
+        const pid_t parent = ::getppid();
+        while (true) {
+            uint32_t seen = sh_->work.prepare();
+            Job j;
+            if (!sh_->tasks.try_pop(j)) {
+                // Orphaned (the parent died or was killed): nobody will
+                // send kExit.
+                if (!sh_->work.wait(seen, kLivenessMs) && ::getppid() != parent) _exit(1);
+                continue;
+            }
+            if (j.kind == kExit) _exit(0);
+
+            const Params& p = sh_->params;
+            cfg.cpu_units = p.cpu_units;
+            cfg.payload_size = p.payload_size;
+            cfg.requests_per_conn = p.requests_per_conn;
+            cfg.pipeline_depth = p.pipeline_depth;
+            Done d{j.index, 0};
+            if (j.kind == kCpu) {
+                d.checksum = cpu_kernel(cfg);
+            } else {
+                *local = LatencySet{};
+                io_one_blocking(cfg, sh_->endpoint, local.get());
+                sh_->latency.merge_atomic(*local);
+            }
+            while (!sh_->results.try_push(d)) std::this_thread::yield();
+            sh_->done.notify(1);
+        }
+    }
+
+    Shared* sh_ = nullptr;
+    std::vector<pid_t> pids_;
+};
+
+static void cpu_prefork(const Config& cfg, ProcessPool& pool) {
+    (void)pool.run_batch(cfg, ProcessPool::kCpu, cfg.tasks, nullptr, nullptr);
+}
+
+static void io_prefork(const Config& cfg, ProcessPool& pool, const Endpoint& ep, LatencySet& lat) {
+    (void)pool.run_batch(cfg, ProcessPool::kIo, cfg.tasks, &ep, &lat);
+}
+
+// Children can't write to the parent's heap, so they record into one
+// MAP_SHARED histogram set with atomic adds; the parent merges it at the end.
+static void io_processes(const Config& cfg, const Endpoint& ep, LatencySet& lat) {
+    void* mem = ::mmap(nullptr, sizeof(LatencySet), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        std::perror("mmap");
+        std::exit(1);
+    }
+    LatencySet* shared = (LatencySet*)mem;
+
+    int launched = 0;
+    int completed = 0;
+
+    while (completed < cfg.tasks) {
+        while (launched - completed < cfg.concurrency && launched < cfg.tasks) {
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                pin_client(cfg, launched);
+                LatencySet local{};
+                io_one_blocking(cfg, ep, &local);
+                shared->merge_atomic(local);
+                _exit(0);
+            }
+            launched++;
+        }
+        int status = 0;
+        (void)reap_child(&status);
+        completed++;
+    }
+
+    lat.merge(*shared);
+    ::munmap(mem, sizeof(LatencySet));
+}
+
+
+// Intrusive timer for TimerWheel; the owner (usually an awaiter in a
+// coroutine frame) keeps it alive while armed.
+struct Timer {
+    uint64_t expiry = 0; // in wheel ticks (ms)
+    Timer* prev = nullptr;
+    Timer* next = nullptr;
+    void (*fn)(void*) = nullptr;
+    void* ctx = nullptr;
+
+    bool armed() const { return next != nullptr; }
+};
+
+// Hierarchical timer wheel with 1 ms ticks: four levels of 64 slots cover
+// 64^4 ms (~4.6 h); anything later parks in the top level and is re-filed
+// when it cascades down. Arm and cancel are O(1); advance() costs one step
+// per elapsed tick plus the timers it cascades or fires.
+class TimerWheel {
+public:
+    static constexpr int kBits = 6;
+    static constexpr int kSlots = 1 << kBits;
+    static constexpr int kLevels = 4;
+
+    TimerWheel() : now_(now_ticks()) {
+        for (auto& level : slots_) {
+            for (auto& head : level) head.prev = head.next = &head;
+        }
+    }
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    static uint64_t now_ticks() { return now_ns() / 1000000; }
+
+    size_t size() const { return size_; }
+
+    // Fires fn(ctx) from advance() once at least delay_ms have passed.
+    void add(Timer& t, uint64_t delay_ms, void (*fn)(void*), void* ctx) {
+        // now_ only moves in advance(), so it can trail the clock; an idle
+        // wheel just jumps ahead instead of stepping through the gap.
+        uint64_t current = now_ticks();
+        if (size_ == 0) now_ = current;
+        t.expiry = std::max(now_, current) + std::max<uint64_t>(delay_ms, 1);
+        t.fn = fn;
+        t.ctx = ctx;
+        place(t);
+        size_++;
+    }
+
+    void cancel(Timer& t) {
+        if (!t.armed()) return;
+        unlink(t);
+        size_--;
+    }
+
+    // Milliseconds until the next timer might be due, or -1 if none are
+    // armed. Exact for the bottom level; for higher ones it is the tick at
+    // which the nearest occupied slot cascades.
+    int next_timeout_ms() const {
+        if (size_ == 0) return -1;
+        uint64_t current = now_ticks();
+        if (current > now_) return 0;
+        for (int l = 0; l < kLevels; l++) {
+            int shift = l * kBits;
+            uint64_t base = now_ >> shift;
+            for (uint64_t d = 1; d <= (uint64_t)kSlots; d++) {
+                const Timer& head = slots_[l][(base + d) & (kSlots - 1)];
+                if (head.next == &head) continue;
+                uint64_t at = (base + d) << shift;
+                return (int)std::min<uint64_t>(at - now_, INT_MAX);
+            }
+        }
+        return -1;
+    }
+
+    // Fires every timer whose expiry has passed.
+    void advance() {
+        uint64_t target = now_ticks();
+        while (now_ < target && size_ > 0) {
+            now_++;
+            for (int l = 1; l < kLevels; l++) {
+                if ((now_ & ((1ull << (l * kBits)) - 1)) != 0) break;
+                cascade(l, (now_ >> (l * kBits)) & (kSlots - 1));
+            }
+            Timer& head = slots_[0][now_ & (kSlots - 1)];
+            while (head.next != &head) {
+                Timer* t = head.next;
+                unlink(*t);
+                if (t->expiry > now_) {
+                    place(*t);
+                    continue;
+                }
+                size_--;
+                t->fn(t->ctx);
+            }
+        }
+        if (size_ == 0) now_ = target;
+    }
+
+private:
+    void place(Timer& t) {
+        uint64_t delta = t.expiry > now_ ? t.expiry - now_ : 1;
+        int l = 0;
+        while (l < kLevels - 1 && delta >= (1ull << ((l + 1) * kBits))) l++;
+        uint64_t max_delta = (1ull << ((l + 1) * kBits)) - 1;
+        uint64_t at = now_ + std::min(delta, max_delta);
+        link(slots_[l][(at >> (l * kBits)) & (kSlots - 1)], t);
+    }
+
+    void cascade(int level, uint64_t slot) {
+        Timer& head = slots_[level][slot];
+        while (head.next != &head) {
+            Timer* t = head.next;
+            unlink(*t);
+            place(*t);
+        }
+    }
+
+    static void link(Timer& head, Timer& t) {
+        t.prev = head.prev;
+        t.next = &head;
+        head.prev->next = &t;
+        head.prev = &t;
+    }
+    static void unlink(Timer& t) {
+        t.prev->next = t.next;
+        t.next->prev = t.prev;
+        t.prev = t.next = nullptr;
+    }
+
+    Timer slots_[kLevels][kSlots];
+    uint64_t now_;
+    size_t size_ = 0;
+};
+
+// Readiness notification backend for the coroutine I/O model. Every arm is
+// one-shot: after the event fires the fd is disarmed until armed again. The
+// two directions are independent, so one coroutine may wait to read an fd
+// while another waits to write it. A coroutine may also arm both directions
+// with its own handle to wait for whichever comes first (FdEither): when
+// both fire in one batch it is resumed once, and it disarms the other
+// direction itself.
+//
+// Each poll() waits no longer than the nearest timer, resumes the fd events
+// it got and only then fires expired timers: an fd event and a timeout for
+// the same waiter can land in one batch, and by the time the timer runs the
+// waiter has already been resumed and cancelled it, so no stale event is
+// left pointing at a coroutine the timeout path resumed.
+class EventLoop {
+public:
+    virtual ~EventLoop() = default;
+
+    virtual void arm_read(int fd, std::coroutine_handle<> h) = 0;
+    virtual void arm_write(int fd, std::coroutine_handle<> h) = 0;
+    // Drops a pending arm_read (or, with write, arm_write) on fd without
+    // resuming anyone; a wait in the other direction stays armed.
+    virtual void disarm(int fd, bool write) = 0;
+    // Coroutines close fds they have waited on through here, so backends
+    // that cache per-fd state can forget it.
+    virtual void close_fd(int fd) { ::close(fd); }
+
+    // Waits up to timeout_ms (-1: until something happens) for events and
+    // timers and resumes their coroutines.
+    void poll(int timeout_ms) {
+        int t = timers.next_timeout_ms();
+        if (t < 0 || (timeout_ms >= 0 && timeout_ms < t)) t = timeout_ms;
+        wait(t);
+        timers.advance();
+    }
+
+    void run_until(std::atomic<int>& pending) {
+        while (pending.load(std::memory_order_acquire) > 0) poll(-1);
+    }
+
+    TimerWheel timers;
+    // Registration syscalls issued by arms/disarms, and blocking waits.
+    uint64_t ctl_calls = 0;
+    uint64_t wait_calls = 0;
+
+protected:
+    virtual void wait(int timeout_ms) = 0;
+};
+
+#if defined(BENCH_HAVE_KQUEUE)
+class KqueueLoop : public EventLoop {
+public:
+    explicit KqueueLoop(bool batched) : batched_(batched) {
+        kq_ = ::kqueue();
+        if (kq_ < 0) {
+            std::perror("kqueue");
+            std::exit(1);
+        }
+    }
+    ~KqueueLoop() override { ::close(kq_); }
+
+    void arm_read(int fd, std::coroutine_handle<> h) override {
+        change(fd, EVFILT_READ, EV_ADD | EV_ONESHOT, h.address(), "kevent arm_read");
+    }
+    void arm_write(int fd, std::coroutine_handle<> h) override {
+        change(fd, EVFILT_WRITE, EV_ADD | EV_ONESHOT, h.address(), "kevent arm_write");
+    }
+
+    void disarm(int fd, bool write) override {
+        // The filter may already have fired and gone; ENOENT is fine.
+        change(fd, write ? EVFILT_WRITE : EVFILT_READ, EV_DELETE, nullptr, nullptr);
+    }
+
+    // Pending changes for fd would fail with EBADF (or hit a reused fd
+    // number) once it is closed, so they are dropped first.
+    void close_fd(int fd) override {
+        changes_.erase(std::remove_if(changes_.begin(), changes_.end(),
+                                      [fd](const struct kevent& k) { return (int)k.ident == fd; }),
+                       changes_.end());
+        ::close(fd);
+    }
+
+protected:
+    // In batched mode the changelist accumulated since the last wait goes in
+    // with this kevent() call, so an arm costs no syscall of its own. A
+    // change that fails comes back as an EV_ERROR event; only failed deletes
+    // (udata == nullptr) are expected.
+    void wait(int timeout_ms) override {
+        constexpr int MAXEV = 256;
+        struct kevent evs[MAXEV];
+
+        timespec ts{};
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+
+        wait_calls++;
+        int n = ::kevent(kq_, changes_.data(), (int)changes_.size(), evs, MAXEV, timeout_ms < 0 ? nullptr : &ts);
+        if (n < 0) {
+            if (errno == EINTR) return;
+            std::perror("kevent wait");
+            std::exit(1);
+        }
+        changes_.clear();
+
+        for (int i = 0; i < n; i++) {
+            void* addr = evs[i].udata;
+            if (evs[i].flags & EV_ERROR) {
+                if (!addr) continue;
+                errno = (int)evs[i].data;
+                std::perror("kevent change");
+                std::exit(1);
+            }
+            if (!addr) continue;
+            // Read and write on one fd armed by the same FdEither waiter: the
+            // first resumes it, and by then the second is stale.
+            bool dup = false;
+            for (int j = 0; j < i && !dup; j++) dup = evs[j].ident == evs[i].ident && evs[j].udata == addr;
+            if (dup) continue;
+            std::coroutine_handle<> h = std::coroutine_handle<>::from_address(addr);
+            if (h) h.resume();
+        }
+    }
+
+private:
+    void change(int fd, int16_t filter, uint16_t flags, void* udata, const char* what) {
+        struct kevent kev{};
+        EV_SET(&kev, fd, filter, flags, 0, 0, udata);
+        if (batched_) {
+            changes_.push_back(kev);
+            return;
+        }
+        ctl_calls++;
+        if (::kevent(kq_, &kev, 1, nullptr, 0, nullptr) < 0 && what) {
+            std::perror(what);
+            std::exit(1);
+        }
+    }
+
+    int kq_;
+    bool batched_;
+    std::vector<struct kevent> changes_;
+};
+#endif
+
+#if defined(BENCH_HAVE_EPOLL)
+// epoll has no changelist, so the batched mode avoids the per-arm syscall
+// instead: each fd is registered once, edge-triggered for both directions,
+// and arm_read/arm_write only park the waiter in a per-fd table. An edge
+// that arrives with nobody waiting is remembered and resumes the next
+// waiter on the following poll; such a wakeup may be spurious, which the
+// callers' EAGAIN loops already handle. The unbatched mode re-arms an
+// EPOLLONESHOT registration with EPOLL_CTL_MOD on every wait, with the
+// events of both directions' waiters merged into one mask.
+class EpollLoop : public EventLoop {
+public:
+    explicit EpollLoop(bool batched) : batched_(batched) {
+        ep_ = ::epoll_create1(EPOLL_CLOEXEC);
+        if (ep_ < 0) {
+            std::perror("epoll_create1");
+            std::exit(1);
+        }
+    }
+    ~EpollLoop() override { ::close(ep_); }
+
+    void arm_read(int fd, std::coroutine_handle<> h) override {
+        if (batched_) park(fd, h, true);
+        else arm_oneshot(fd, h, true);
+    }
+    void arm_write(int fd, std::coroutine_handle<> h) override {
+        if (batched_) park(fd, h, false);
+        else arm_oneshot(fd, h, false);
+    }
+
+    void disarm(int fd, bool write) override {
+        if ((size_t)fd >= fds_.size()) return;
+        FdState& st = fds_[(size_t)fd];
+        (write ? st.writer : st.reader) = nullptr;
+        if (!batched_) {
+            rearm(fd, st);
+            return;
+        }
+        ready_.erase(std::remove_if(ready_.begin(), ready_.end(),
+                                    [fd, write](const Ready& r) { return r.fd == fd && r.write == write; }),
+                     ready_.end());
+    }
+
+    // Closing the fd drops its epoll registration, so the table entry must
+    // go too or a reused fd number would never be registered again.
+    void close_fd(int fd) override {
+        if ((size_t)fd < fds_.size()) fds_[(size_t)fd] = FdState{};
+        ::close(fd);
+    }
+
+protected:
+    void wait(int timeout_ms) override {
+        constexpr int MAXEV = 256;
+        epoll_event evs[MAXEV];
+
+        if (!ready_.empty()) timeout_ms = 0;
+        wait_calls++;
+        int n = ::epoll_wait(ep_, evs, MAXEV, timeout_ms);
+        if (n < 0) {
+            if (errno == EINTR) return;
+            std::perror("epoll_wait");
+            std::exit(1);
+        }
+
+        // Collect everything before resuming anyone: a resumed coroutine may
+        // close its fd and open another with the same number.
+        // An FdEither waiter that is resumed through one direction no longer
+        // waits on the other, so it is taken out of both slots.
+        std::vector<Ready> run;
+        run.swap(ready_);
+        for (const Ready& r : run) forget(fds_[(size_t)r.fd], r.h);
+        for (int i = 0; i < n; i++) {
+            int fd = evs[i].data.fd;
+            FdState& st = fds_[(size_t)fd];
+            uint32_t e = evs[i].events;
+            if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                if (st.reader) run.push_back({fd, false, forget(st, st.reader)});
+                else st.readable = true;
+            }
+            if (e & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+                if (st.writer) run.push_back({fd, true, forget(st, st.writer)});
+                else st.writable = true;
+            }
+            // The one-shot fired for both directions; a waiter whose event
+            // has not come yet needs its interest back.
+            if (!batched_) {
+                st.armed = 0;
+                rearm(fd, st);
+            }
+        }
+        for (const Ready& r : run) std::coroutine_handle<>::from_address(r.h).resume();
+    }
+
+private:
+    struct FdState {
+        void* reader = nullptr;
+        void* writer = nullptr;
+        bool registered = false;
+        bool readable = false; // edges seen with no waiter (batched only)
+        bool writable = false;
+        uint32_t armed = 0;    // events in the live one-shot (unbatched only)
+    };
+    struct Ready {
+        int fd;
+        bool write;
+        void* h;
+    };
+
+    static void* forget(FdState& st, void* h) {
+        if (st.reader == h) st.reader = nullptr;
+        if (st.writer == h) st.writer = nullptr;
+        return h;
+    }
+
+    void park(int fd, std::coroutine_handle<> h, bool read) {
+        if ((size_t)fd >= fds_.size()) fds_.resize((size_t)fd + 1);
+        FdState& st = fds_[(size_t)fd];
+        if (!st.registered) {
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.fd = fd;
+            ctl_calls++;
+            if (::epoll_ctl(ep_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                std::perror("epoll_ctl register");
+                std::exit(1);
+            }
+            st.registered = true;
+        }
+        bool& edge = read ? st.readable : st.writable;
+        // FdEither already queued through the other direction: keep the edge.
+        if (edge && !ready_.empty() && ready_.back().fd == fd && ready_.back().h == h.address()) return;
+        if (edge) {
+            edge = false;
+            ready_.push_back({fd, !read, h.address()});
+        } else {
+            (read ? st.reader : st.writer) = h.address();
+        }
+    }
+
+    // EPOLLONESHOT disarms the registration after delivery (like EV_ONESHOT);
+    // the next arm re-enables it with EPOLL_CTL_MOD. epoll allows one
+    // registration per fd, so its mask covers whichever of the reader and
+    // writer are waiting. Closing the fd drops the registration, so a reused
+    // fd number starts with ADD again.
+    void arm_oneshot(int fd, std::coroutine_handle<> h, bool read) {
+        if ((size_t)fd >= fds_.size()) fds_.resize((size_t)fd + 1);
+        FdState& st = fds_[(size_t)fd];
+        (read ? st.reader : st.writer) = h.address();
+        rearm(fd, st);
+    }
+
+    void rearm(int fd, FdState& st) {
+        uint32_t want = (st.reader ? (uint32_t)(EPOLLIN | EPOLLRDHUP) : 0u) | (st.writer ? (uint32_t)EPOLLOUT : 0u);
+        if (want == st.armed) return;
+        epoll_event ev{};
+        ev.events = want | EPOLLET | EPOLLONESHOT;
+        ev.data.fd = fd;
+        ctl_calls++;
+        int rc = ::epoll_ctl(ep_, st.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev);
+        if (rc < 0 && (errno == EEXIST || errno == ENOENT)) {
+            // The fd was closed or registered behind our back; try the other op.
+            ctl_calls++;
+            rc = ::epoll_ctl(ep_, errno == EEXIST ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev);
+        }
+        if (rc < 0) {
+            std::perror(want ? "epoll_ctl arm" : "epoll_ctl disarm");
+            std::exit(1);
+        }
+        st.registered = true;
+        st.armed = want;
+    }
+
+    int ep_;
+    bool batched_;
+    std::vector<FdState> fds_;
+    std::vector<Ready> ready_;
+};
+#endif
+
+// `batched` picks the changelist (kqueue) / persistent registration (epoll)
+// arm path over one registration syscall per arm.
+static std::unique_ptr<EventLoop> make_event_loop(const std::string& name, bool batched = true) {
+#if defined(BENCH_HAVE_KQUEUE)
+    if (name == "kqueue") return std::make_unique<KqueueLoop>(batched);
+#endif
+#if defined(BENCH_HAVE_EPOLL)
+    if (name == "epoll") return std::make_unique<EpollLoop>(batched);
+#endif
+    (void)batched;
+    std::cerr << "Event loop '" << name << "' is not available on this platform\n";
+    std::exit(1);
+}
+
+struct FdReadable {
+    EventLoop* loop;
+    int fd;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { loop->arm_read(fd, h); }
+    void await_resume() const noexcept {}
+    void cancel() { loop->disarm(fd, false); }
+};
+
+struct FdWritable {
+    EventLoop* loop;
+    int fd;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { loop->arm_write(fd, h); }
+    void await_resume() const noexcept {}
+    void cancel() { loop->disarm(fd, true); }
+};
+
+// Resumes once fd is readable or writable. A pipelined client whose send is
+// stuck waits on this, so it can keep reading the echoes the server is
+// blocked writing.
+struct FdEither {
+    EventLoop* loop;
+    int fd;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        loop->arm_read(fd, h);
+        loop->arm_write(fd, h);
+    }
+    void await_resume() { cancel(); }
+    void cancel() {
+        loop->disarm(fd, false);
+        loop->disarm(fd, true);
+    }
+};
+
+// co_await sleep_for(loop, ms): resumes from the loop's timer wheel.
+struct SleepFor {
+    EventLoop* loop;
+    uint64_t ms;
+    Timer timer{};
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        loop->timers.add(timer, ms, [](void* a) { std::coroutine_handle<>::from_address(a).resume(); }, h.address());
+    }
+    void await_resume() const noexcept {}
+};
+
+static SleepFor sleep_for(EventLoop* loop, uint64_t ms) {
+    return SleepFor{loop, ms};
+}
+
+// co_await with_timeout(FdReadable{...}, ms) yields true once the fd is ready
+// or false after ms, in which case that direction's arm on the fd has been
+// dropped. ms == 0 waits without a timer.
+template <class FdAwait>
+struct WithTimeout {
+    FdAwait inner;
+    uint64_t ms;
+    Timer timer{};
+    std::coroutine_handle<> h{};
+    bool timed_out = false;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> awaiting) {
+        h = awaiting;
+        if (ms) loop()->timers.add(timer, ms, &WithTimeout::expire, this);
+        inner.await_suspend(awaiting);
+    }
+    bool await_resume() {
+        if (timed_out) return false;
+        loop()->timers.cancel(timer);
+        inner.await_resume();
+        return true;
+    }
+
+private:
+    EventLoop* loop() const { return inner.loop; }
+
+    static void expire(void* p) {
+        auto* self = (WithTimeout*)p;
+        self->timed_out = true;
+        self->inner.cancel();
+        self->h.resume();
+    }
+};
+
+template <class FdAwait>
+static WithTimeout<FdAwait> with_timeout(FdAwait inner, int ms) {
+    return WithTimeout<FdAwait>{inner, (uint64_t)std::max(ms, 0)};
+}
+
+struct IoAdmission;
+
+struct IoTask {
+    struct promise_type : PooledFrame {
+        EventLoop* loop = nullptr;
+        IoAdmission* admission = nullptr;
+        int slot = -1;
+
+        IoTask get_return_object() { return IoTask{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct Final {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept;
+            void await_resume() noexcept {}
+        };
+
+        Final final_suspend() noexcept { return {}; }
+
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> h;
+    explicit IoTask(std::coroutine_handle<promise_type> h_) : h(h_) {}
+    IoTask(IoTask&& o) noexcept : h(o.h) { o.h = {}; }
+    ~IoTask() { if (h) h.destroy(); }
+
+    void start(EventLoop* loop, IoAdmission* admission, int slot = -1) {
+        h.promise().loop = loop;
+        h.promise().admission = admission;
+        h.promise().slot = slot;
+        h.resume();
+    }
+};
+
+// A coroutine client's slot buffer: one receive message, padded so the
+// pipeline timestamps that follow it are aligned.
+static size_t slot_msg_bytes(size_t size) {
+    return (size + alignof(uint64_t) - 1) & ~(alignof(uint64_t) - 1);
+}
+static size_t slot_buf_bytes(const Config& cfg) {
+    return slot_msg_bytes(msg_size(cfg)) + (size_t)cfg.pipeline_depth * sizeof(uint64_t);
+}
+
+// Admission control for the coroutine I/O drivers. Every task reports its
+// completion from Final and a replacement is started right there, so exactly
+// `concurrency` clients stay in flight (like the idx.fetch_add loop in
+// io_threads) instead of the batch draining in waves. The loop only needs
+// `pending` to know when everything is done.
+//
+// Tasks live in a fixed array of `concurrency` slots, each with its own
+// receive buffer; a finished slot is reused by the next client, so memory is
+// O(concurrency) regardless of --tasks.
+//
+// With a schedule (open loop) a task is only launched once its arrival time
+// has passed; make() gets that arrival time, or 0 when closed-loop.
+struct IoAdmission {
+    std::atomic<int> pending{0};
+
+    IoAdmission(const Config& cfg, EventLoop* loop, size_t buf_size, std::function<IoTask(char*, uint64_t)> make)
+        : tasks_(cfg.tasks), loop_(loop), make_(std::move(make)), slots_((size_t)cfg.concurrency) {
+        free_.reserve(slots_.size());
+        for (size_t i = slots_.size(); i-- > 0;) {
+            slots_[i].buf.resize(buf_size);
+            free_.push_back((int)i);
+        }
+    }
+
+    void start() { admit(); }
+
+    void set_schedule(std::vector<uint64_t> offsets) {
+        schedule_ = std::move(offsets);
+        base_ = now_ns();
+    }
+
+    bool unlaunched() const { return launched_ < tasks_; }
+
+    // Milliseconds until the next arrival can be launched (rounded down, so
+    // the caller wakes early and spins the last stretch), or -1 if only a
+    // completion can make progress.
+    int next_due_ms() const {
+        if (schedule_.empty() || free_.empty() || launched_ >= tasks_) return -1;
+        uint64_t due = base_ + schedule_[(size_t)launched_];
+        uint64_t now = now_ns();
+        return now >= due ? 0 : (int)std::min<uint64_t>((due - now) / 1000000, 1000);
+    }
+
+    void on_task_done(int slot) {
+        pending.fetch_sub(1, std::memory_order_release);
+        free_.push_back(slot);
+        admit();
+    }
+
+private:
+    struct Slot {
+        std::optional<IoTask> task;
+        std::vector<char> buf;
+    };
+
+    // Re-entrant calls (a task that finishes inside start()) only return the
+    // slot; the outermost call launches, so chains of instant failures don't
+    // recurse. Resetting a slot may destroy the very task whose Final is on
+    // the stack; that is allowed, since Final touches nothing afterwards.
+    void admit() {
+        if (admitting_) return;
+        admitting_ = true;
+        while (!free_.empty() && launched_ < tasks_) {
+            uint64_t due = 0;
+            if (!schedule_.empty()) {
+                due = base_ + schedule_[(size_t)launched_];
+                if (now_ns() < due) break;
+            }
+            int i = free_.back();
+            free_.pop_back();
+            Slot& sl = slots_[(size_t)i];
+            sl.task.reset();
+            launched_++;
+            pending.fetch_add(1, std::memory_order_release);
+            sl.task.emplace(make_(sl.buf.data(), due));
+            sl.task->start(loop_, this, i);
+        }
+        admitting_ = false;
+    }
+
+    int tasks_;
+    EventLoop* loop_;
+    std::function<IoTask(char*, uint64_t)> make_;
+    std::vector<uint64_t> schedule_;
+    uint64_t base_ = 0;
+    int launched_ = 0;
+    bool admitting_ = false;
+    std::vector<Slot> slots_;
+    std::vector<int> free_;
+};
+
+void IoTask::promise_type::Final::await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+    if (h.promise().admission) h.promise().admission->on_task_done(h.promise().slot);
+}
+
+// `buf` holds one message followed by `depth` request timestamps. A nonzero
+// `due` makes this an open-loop task scheduled for that time.
+static IoTask io_client_task(EventLoop* loop, const Endpoint* ep, const char* payload, char* buf, size_t size,
+                             int requests, int depth, LatencySet* lat, int timeout_ms = 0, uint64_t due = 0) {
+    if (due && !open_loop_start(due, timeout_ms, lat)) co_return;
+    uint64_t t0 = now_ns();
+    const uint64_t t_start = due ? due : t0;
+    bool pending;
+    int s = transport_connect(*ep, true, 0, &pending);
+    if (s < 0) co_return;
+
+    if (pending) {
+        if (!co_await with_timeout(FdWritable{loop, s}, timeout_ms)) {
+            loop->close_fd(s);
+            co_return;
+        }
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            loop->close_fd(s);
+            co_return;
+        }
+    }
+    lat->connect.record(now_ns() - t0);
+
+    PipelineWindow win{requests, depth, (uint64_t*)(buf + slot_msg_bytes(size))};
+
+    // A send that would block waits for room or for echoes, whichever comes
+    // first: with a window larger than the socket buffers the server is
+    // blocked writing those echoes until we read them.
+    while (!win.done()) {
+        while (win.can_send()) {
+            MsgHeader h{win.next_send, (uint32_t)size};
+            win.stamp(win.next_send) = win.next_send == 0 ? t_start : now_ns();
+            size_t off = 0;
+            while (off < size) {
+                iovec iov[2];
+                msghdr mh{};
+                mh.msg_iov = iov;
+                mh.msg_iovlen = msg_iov(iov, &h, payload, size, off);
+                ssize_t w = ::sendmsg(s, &mh, 0);
+                if (w > 0) { off += (size_t)w; continue; }
+                if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    int r = pipeline_drain(s, buf, size, win, true, lat);
+                    if (r > 0) continue;
+                    if (r == 0 && co_await with_timeout(FdEither{loop, s}, timeout_ms)) continue;
+                }
+                loop->close_fd(s);
+                co_return;
+            }
+            win.next_send++;
+        }
+
+        int r = pipeline_drain(s, buf, size, win, false, lat);
+        if (r < 0 || (r == 0 && !co_await with_timeout(FdReadable{loop, s}, timeout_ms))) {
+            loop->close_fd(s);
+            co_return;
+        }
+    }
+
+    loop->close_fd(s);
+    co_return;
+}
+
+// Open loop keeps at most `concurrency` clients in flight too; arrivals that
+// find every slot taken wait for one, and that wait counts as latency.
+static void io_coroutines(const Config& cfg, const Endpoint& ep, LatencySet& lat, bool open_loop = false) {
+    ScopedPin pin(cfg);
+    std::unique_ptr<EventLoop> loop = make_event_loop(cfg.loop, cfg.arm == "batched");
+    const std::vector<char> payload(msg_size(cfg), 'x');
+    IoAdmission admission(cfg, loop.get(), slot_buf_bytes(cfg), [&](char* buf, uint64_t due) {
+        return io_client_task(loop.get(), &ep, payload.data(), buf, payload.size(),
+                              cfg.requests_per_conn, cfg.pipeline_depth, &lat, cfg.timeout_ms, due);
+    });
+    if (!open_loop) {
+        admission.start();
+        loop->run_until(admission.pending);
+    } else {
+        admission.set_schedule(arrival_schedule(cfg));
+        admission.start();
+        while (admission.pending.load(std::memory_order_acquire) > 0 || admission.unlaunched()) {
+            int wait = admission.next_due_ms();
+            loop->poll(wait < 0 ? 1000 : wait);
+            admission.start();
+        }
+    }
+    g_loop_ctl.fetch_add((int64_t)loop->ctl_calls, std::memory_order_relaxed);
+    g_loop_wait.fetch_add((int64_t)loop->wait_calls, std::memory_order_relaxed);
+}
+
+// Lateness counts from when the loop started running (*started), not from
+// the deadline, for timers that fell due while the rest were still being armed.
+static IoTask timer_sleeper(EventLoop* loop, uint64_t ms, Histogram* late, const uint64_t* started,
+                            std::atomic<int>* pending) {
+    uint64_t due = now_ns() + ms * 1000000;
+    co_await sleep_for(loop, ms);
+    uint64_t now = now_ns();
+    due = std::max(due, *started);
+    late->record(now > due ? now - due : 0);
+    pending->fetch_sub(1, std::memory_order_release);
+}
+
+// --timers N: raw wheel arm and cancel cost with N timers pending, then N
+// sleeping coroutines on one event loop with delays spread over
+// --timer-span-ms, recording how late each one woke up.
+static void run_timer_bench(const Config& cfg) {
+    const int n = cfg.timers;
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> delays((size_t)n);
+    for (auto& d : delays) d = 1 + rng() % (uint64_t)cfg.timer_span_ms;
+
+    struct Row {
+        const char* name;
+        double elapsed;
+        const Histogram* late;
+    };
+    std::vector<Row> rows;
+
+    TimerWheel wheel;
+    std::vector<Timer> timers((size_t)n);
+    double t0 = seconds_now();
+    for (int i = 0; i < n; i++) wheel.add(timers[(size_t)i], delays[(size_t)i], [](void*) {}, nullptr);
+    double t1 = seconds_now();
+    for (auto& t : timers) wheel.cancel(t);
+    double t2 = seconds_now();
+    rows.push_back({"arm", t1 - t0, nullptr});
+    rows.push_back({"cancel", t2 - t1, nullptr});
+
+    auto late = std::make_unique<Histogram>();
+    std::unique_ptr<EventLoop> loop = make_event_loop(cfg.loop, cfg.arm == "batched");
+    std::atomic<int> pending{n};
+    std::vector<IoTask> sleepers;
+    sleepers.reserve((size_t)n);
+    uint64_t started = UINT64_MAX;
+    double t3 = seconds_now();
+    for (int i = 0; i < n; i++) {
+        sleepers.push_back(timer_sleeper(loop.get(), delays[(size_t)i], late.get(), &started, &pending));
+        sleepers.back().start(loop.get(), nullptr);
+    }
+    started = now_ns();
+    loop->run_until(pending);
+    rows.push_back({"sleep_for", seconds_now() - t3, late.get()});
+
+    std::cout << "| Benchmark | Timers | Elapsed | Per timer | Late p50 | Late p99 | Late max |\n";
+    std::cout << "|----------:|-------:|--------:|----------:|---------:|---------:|---------:|\n";
+    for (const auto& r : rows) {
+        std::ostringstream per;
+        per << std::fixed << std::setprecision(1) << r.elapsed * 1e9 / n << " ns";
+        std::cout << "| " << r.name
+                  << " | " << n
+                  << " | " << fmt_sec(r.elapsed)
+                  << " | " << per.str()
+                  << " | " << (r.late ? fmt_us(r.late->percentile(50)) : "-")
+                  << " | " << (r.late ? fmt_us(r.late->percentile(99)) : "-")
+                  << " | " << (r.late ? fmt_us(r.late->max) : "-")
+                  << " |\n";
+    }
+    std::cout << "\n";
+}
+
+// ---- Streaming ----
+//
+// --stream-mb rows measure bulk transfer instead of small round trips: a few
+// long connections (--stream-conns) each send their share of the run's bytes
+// in --stream-chunk-kb writes and read the echo back at the same time. All
+// senders write from one shared pre-filled buffer and each receiver reuses
+// one chunk, so nothing is allocated or filled per message.
+
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendNoSignal = MSG_NOSIGNAL;
+#else
+constexpr int kSendNoSignal = 0;
+#endif
+
+static const char* stream_source(size_t bytes) {
+    static std::vector<char> src;
+    if (src.size() < bytes) src.assign(bytes, 'x');
+    return src.data();
+}
+
+// Connection i's share of --stream-mb; the first one takes the remainder.
+static uint64_t stream_share(const Config& cfg, int i) {
+    const uint64_t total = (uint64_t)cfg.stream_mb << 20;
+    const uint64_t share = total / (uint64_t)cfg.stream_conns;
+    return i == 0 ? share + total % (uint64_t)cfg.stream_conns : share;
+}
+
+// Blocking sockets: each connection's thread receives while a helper thread
+// sends. A failure on either side shuts the socket down to wake the other.
+// `total` records each connection that got all of its bytes back.
+static void stream_threads(const Config& cfg, const Endpoint& ep, LatencySet& lat) {
+    const size_t chunk = (size_t)cfg.stream_chunk_kb << 10;
+    const char* src = stream_source(chunk);
+    std::mutex lat_mu;
+    std::vector<std::thread> conns;
+    conns.reserve((size_t)cfg.stream_conns);
+
+    for (int i = 0; i < cfg.stream_conns; i++) {
+        conns.emplace_back([&, i] {
+            pin_client(cfg, i);
+            const uint64_t bytes = stream_share(cfg, i);
+            uint64_t t0 = now_ns();
+            bool pending;
+            int s = transport_connect(ep, false, cfg.timeout_ms, &pending);
+            if (s < 0) return;
+
+            std::thread sender([&] {
+                uint64_t sent = 0;
+                while (sent < bytes) {
+                    ssize_t w = ::send(s, src, (size_t)std::min<uint64_t>(chunk, bytes - sent), kSendNoSignal);
+                    if (w > 0) { sent += (uint64_t)w; continue; }
+                    if (w < 0 && errno == EINTR) continue;
+                    ::shutdown(s, SHUT_RDWR);
+                    return;
+                }
+            });
+            std::vector<char> sink(chunk);
+            uint64_t got = 0;
+            while (got < bytes) {
+                ssize_t n = ::recv(s, sink.data(), sink.size(), 0);
+                if (n > 0) { got += (uint64_t)n; continue; }
+                if (n < 0 && errno == EINTR) continue;
+                ::shutdown(s, SHUT_RDWR);
+                break;
+            }
+            sender.join();
+            ::close(s);
+            if (got < bytes) return;
+            std::lock_guard<std::mutex> lk(lat_mu);
+            lat.total.record(now_ns() - t0);
+        });
+    }
+    for (auto& th : conns) th.join();
+}
+
+static IoTask stream_writer(EventLoop* loop, int s, const char* src, size_t chunk, uint64_t bytes, int timeout_ms,
+                            std::atomic<int>* pending) {
+    uint64_t sent = 0;
+    while (sent < bytes) {
+        ssize_t w = ::send(s, src, (size_t)std::min<uint64_t>(chunk, bytes - sent), kSendNoSignal);
+        if (w > 0) { sent += (uint64_t)w; continue; }
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (co_await with_timeout(FdWritable{loop, s}, timeout_ms)) continue;
+        }
+        if (w < 0 && errno == EINTR) continue;
+        ::shutdown(s, SHUT_RDWR);
+        break;
+    }
+    pending->fetch_sub(1, std::memory_order_release);
+}
+
+static IoTask stream_reader(EventLoop* loop, int s, char* sink, size_t chunk, uint64_t bytes, int timeout_ms,
+                            uint64_t t0, LatencySet* lat, std::atomic<int>* pending) {
+    uint64_t got = 0;
+    while (got < bytes) {
+        ssize_t n = ::recv(s, sink, chunk, 0);
+        if (n > 0) { got += (uint64_t)n; continue; }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (co_await with_timeout(FdReadable{loop, s}, timeout_ms)) continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        ::shutdown(s, SHUT_RDWR);
+        break;
+    }
+    if (got == bytes) lat->total.record(now_ns() - t0);
+    pending->fetch_sub(1, std::memory_order_release);
+}
+
+// One event loop, with a writer and a reader coroutine per connection. Both
+// wait on the same socket: kqueue keeps a filter per direction, and epoll
+// merges the two waiters into the fd's one registration.
+static void stream_coroutines(const Config& cfg, const Endpoint& ep, LatencySet& lat) {
+    ScopedPin pin(cfg);
+    std::unique_ptr<EventLoop> loop = make_event_loop(cfg.loop, cfg.arm == "batched");
+    const size_t chunk = (size_t)cfg.stream_chunk_kb << 10;
+    const char* src = stream_source(chunk);
+    std::vector<char> sinks((size_t)cfg.stream_conns * chunk);
+    std::vector<int> fds;
+    std::vector<IoTask> tasks;
+    std::atomic<int> pending{0};
+
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < cfg.stream_conns; i++) {
+        bool connecting;
+        int s = transport_connect(ep, false, cfg.timeout_ms, &connecting);
+        if (s < 0) continue;
+        if (set_nonblocking(s) < 0) {
+            ::close(s);
+            continue;
+        }
+        fds.push_back(s);
+        const uint64_t bytes = stream_share(cfg, i);
+        tasks.push_back(stream_writer(loop.get(), s, src, chunk, bytes, cfg.timeout_ms, &pending));
+        tasks.push_back(stream_reader(loop.get(), s, sinks.data() + (size_t)i * chunk, chunk, bytes, cfg.timeout_ms,
+                                      t0, &lat, &pending));
+    }
+    pending.store((int)tasks.size(), std::memory_order_relaxed);
+    for (auto& t : tasks) t.start(loop.get(), nullptr);
+    loop->run_until(pending);
+    for (int s : fds) loop->close_fd(s);
+
+    g_loop_ctl.fetch_add((int64_t)loop->ctl_calls, std::memory_order_relaxed);
+    g_loop_wait.fetch_add((int64_t)loop->wait_calls, std::memory_order_relaxed);
+}
+
+// ---- Stackful fibers ----
+//
+// Each fiber runs on its own mmap'd stack with a PROT_NONE guard page below
+// it, so an overflow faults instead of corrupting a neighbour. Stacks come
+// from a per-scheduler free list, so steady-state spawns map nothing. Fibers
+// switch with bench_fiber_switch (callee-saved registers plus the stack
+// pointer, no syscalls) or, with --fiber-switch ucontext, swapcontext (which
+// also saves the signal mask, one rt_sigprocmask per switch on Linux).
+//
+// A blocked fiber waits on the same EventLoop as the coroutine models: it
+// arms the loop with its wake coroutine, a stackless coroutine that does
+// nothing but switch back into the fiber when the loop resumes it. That
+// leaves the kqueue/epoll backends untouched and the fiber code can stay
+// blocking-style, like io_one_blocking.
+
+#if defined(BENCH_HAVE_FIBER_ASM)
+extern "C" void bench_fiber_switch(void** save_sp, void* load_sp);
+extern "C" void bench_fiber_start();
+
+#if defined(__APPLE__)
+#define BENCH_ASM_SYM(name) "_" #name
+#else
+#define BENCH_ASM_SYM(name) #name
+#endif
+
+// bench_fiber_switch pushes the callee-saved registers, stores the stack
+// pointer in *save_sp, loads load_sp and pops the other side's. A new fiber's
+// stack is laid out so that the first switch "returns" into
+// bench_fiber_start, which calls fn(arg) from two of the restored registers.
+#if defined(__x86_64__)
+asm(".text\n"
+    ".p2align 4\n"
+    ".globl " BENCH_ASM_SYM(bench_fiber_switch) "\n"
+    BENCH_ASM_SYM(bench_fiber_switch) ":\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".p2align 4\n"
+    ".globl " BENCH_ASM_SYM(bench_fiber_start) "\n"
+    BENCH_ASM_SYM(bench_fiber_start) ":\n"
+    "    movq %rbx, %rdi\n"
+    "    callq *%r12\n"
+    "    ud2\n");
+#elif defined(__aarch64__)
+asm(".text\n"
+    ".p2align 4\n"
+    ".globl " BENCH_ASM_SYM(bench_fiber_switch) "\n"
+    BENCH_ASM_SYM(bench_fiber_switch) ":\n"
+    "    sub sp, sp, #160\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x9, sp\n"
+    "    str x9, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #160\n"
+    "    ret\n"
+    ".p2align 4\n"
+    ".globl " BENCH_ASM_SYM(bench_fiber_start) "\n"
+    BENCH_ASM_SYM(bench_fiber_start) ":\n"
+    "    mov x0, x19\n"
+    "    blr x20\n"
+    "    brk #0\n");
+#endif
+
+// Initial stack pointer for a fiber whose first switch calls fn(arg).
+static void* fiber_initial_sp(char* top, void (*fn)(void*), void* arg) {
+    auto* sp = (void**)((uintptr_t)top & ~(uintptr_t)15);
+#if defined(__x86_64__)
+    // After the six pops and the ret, rsp must be 16-aligned for the call.
+    sp -= 2;
+    *--sp = (void*)&bench_fiber_start;
+    *--sp = nullptr;      // rbp
+    *--sp = arg;          // rbx
+    *--sp = (void*)fn;    // r12
+    *--sp = nullptr;      // r13
+    *--sp = nullptr;      // r14
+    *--sp = nullptr;      // r15
+#else
+    sp -= 20;
+    std::memset(sp, 0, 20 * sizeof(void*));
+    sp[0] = arg;                         // x19
+    sp[1] = (void*)fn;                   // x20
+    sp[11] = (void*)&bench_fiber_start;  // x30
+#endif
+    return sp;
+}
+#endif
+
+class FiberStackPool {
+public:
+    explicit FiberStackPool(size_t size)
+        : page_((size_t)sysconf(_SC_PAGESIZE)), size_((size + page_ - 1) / page_ * page_) {}
+    ~FiberStackPool() {
+        for (char* base : free_) ::munmap(base, page_ + size_);
+    }
+
+    // Returns the lowest address of the mapping; the usable stack is
+    // [base + page, base + page + size).
+    char* take() {
+        if (!free_.empty()) {
+            char* base = free_.back();
+            free_.pop_back();
+            return base;
+        }
+        void* p = ::mmap(nullptr, page_ + size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            std::perror("mmap fiber stack");
+            std::exit(1);
+        }
+        if (::mprotect(p, page_, PROT_NONE) < 0) {
+            std::perror("mprotect fiber guard");
+            std::exit(1);
+        }
+        return (char*)p;
+    }
+    void give(char* base) { free_.push_back(base); }
+    char* top(char* base) const { return base + page_ + size_; }
+    size_t size() const { return size_; }
+
+private:
+    size_t page_;
+    size_t size_;
+    std::vector<char*> free_;
+};
+
+class FiberScheduler;
+
+// Resumed by an EventLoop or timer in place of a coroutine; switches into
+// its fiber and suspends again once the fiber switches back out.
+struct FiberWake {
+    struct promise_type {
+        FiberWake get_return_object() { return FiberWake{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> h;
+};
+
+struct Fiber {
+    void* sp = nullptr; // saved while switched out
+#if defined(BENCH_HAVE_UCONTEXT)
+    ucontext_t uc{};
+#endif
+    char* stack = nullptr;
+    std::function<void()> body;
+    bool done = false;
+    FiberWake wake{};
+    // wait_fd's timeout
+    Timer timer{};
+    int wait_fd = -1;
+    int wait_dirs = 0; // kWaitRead | kWaitWrite
+    bool timed_out = false;
+    FiberScheduler* sched = nullptr;
+};
+
+// Runs fibers on the calling thread. spawn() queues a fiber, run() drives
+// them: ready fibers first, then the event loop (if any) until every fiber
+// has returned.
+class FiberScheduler {
+public:
+    FiberScheduler(const Config& cfg, EventLoop* loop)
+        : loop_(loop), stacks_((size_t)cfg.fiber_stack_kb * 1024), ucontext_(cfg.fiber_switch == "ucontext") {}
+
+    ~FiberScheduler() {
+        for (auto& f : fibers_) {
+            if (f->wake.h) f->wake.h.destroy();
+            if (f->stack) stacks_.give(f->stack);
+        }
+    }
+
+    void spawn(std::function<void()> body) {
+        Fiber* f;
+        if (!idle_.empty()) {
+            f = idle_.back();
+            idle_.pop_back();
+        } else {
+            fibers_.push_back(std::make_unique<Fiber>());
+            f = fibers_.back().get();
+            f->sched = this;
+            f->wake = wake_loop(f);
+        }
+        f->body = std::move(body);
+        f->done = false;
+        f->stack = stacks_.take();
+        char* top = stacks_.top(f->stack);
+#if defined(BENCH_HAVE_UCONTEXT)
+        if (ucontext_) {
+            getcontext(&f->uc);
+            f->uc.uc_stack.ss_sp = top - stacks_.size();
+            f->uc.uc_stack.ss_size = stacks_.size();
+            f->uc.uc_link = nullptr;
+            makecontext(&f->uc, (void (*)())&FiberScheduler::uc_entry, 0);
+        }
+#endif
+#if defined(BENCH_HAVE_FIBER_ASM)
+        if (!ucontext_) f->sp = fiber_initial_sp(top, &FiberScheduler::entry, f);
+#endif
+        (void)top;
+        alive_++;
+        ready_.push_back(f);
+    }
+
+    // Lets the other ready fibers run, then continues.
+    void yield() {
+        ready_.push_back(current_);
+        switch_out();
+    }
+
+    // Blocks the current fiber until fd is readable/writable; false if
+    // timeout_ms (> 0) passed first, in which case the arm has been dropped.
+    bool wait_readable(int fd, int timeout_ms) { return wait_fd(fd, kWaitRead, timeout_ms); }
+    bool wait_writable(int fd, int timeout_ms) { return wait_fd(fd, kWaitWrite, timeout_ms); }
+    // Either direction, as FdEither does for coroutines.
+    bool wait_either(int fd, int timeout_ms) { return wait_fd(fd, kWaitRead | kWaitWrite, timeout_ms); }
+
+    void run() {
+        while (alive_ > 0) {
+            while (!ready_.empty()) {
+                Fiber* f = ready_.front();
+                ready_.pop_front();
+                switch_in(f);
+            }
+            if (alive_ > 0 && loop_) loop_->poll(-1);
+        }
+    }
+
+    EventLoop* loop() const { return loop_; }
+
+private:
+    EventLoop* loop_;
+    FiberStackPool stacks_;
+    bool ucontext_;
+    void* main_sp_ = nullptr;
+#if defined(BENCH_HAVE_UCONTEXT)
+    ucontext_t main_uc_{};
+#endif
+    Fiber* current_ = nullptr;
+    std::deque<Fiber*> ready_;
+    std::vector<std::unique_ptr<Fiber>> fibers_;
+    std::vector<Fiber*> idle_;
+    int alive_ = 0;
+
+    static thread_local Fiber* t_starting_;
+
+    // Starts suspended; every resume switches into f once.
+    static FiberWake wake_loop(Fiber* f) {
+        while (true) {
+            f->sched->switch_in(f);
+            co_await std::suspend_always{};
+        }
+    }
+
+    static void entry(void* arg) {
+        auto* f = (Fiber*)arg;
+        f->body();
+        f->body = nullptr;
+        f->done = true;
+        f->sched->switch_out();
+    }
+
+#if defined(BENCH_HAVE_UCONTEXT)
+    static void uc_entry() { entry(t_starting_); }
+#endif
+
+    // From the scheduler's stack (run() or a wake coroutine) into f. Once f
+    // has returned its stack goes back to the pool here, off that stack.
+    void switch_in(Fiber* f) {
+        current_ = f;
+#if defined(BENCH_HAVE_UCONTEXT)
+        if (ucontext_) {
+            t_starting_ = f;
+            swapcontext(&main_uc_, &f->uc);
+        }
+#endif
+#if defined(BENCH_HAVE_FIBER_ASM)
+        if (!ucontext_) bench_fiber_switch(&main_sp_, f->sp);
+#endif
+        current_ = nullptr;
+        if (f->done) {
+            stacks_.give(f->stack);
+            f->stack = nullptr;
+            idle_.push_back(f);
+            alive_--;
+        }
+    }
+
+    void switch_out() {
+        Fiber* f = current_;
+#if defined(BENCH_HAVE_UCONTEXT)
+        if (ucontext_) swapcontext(&f->uc, &main_uc_);
+#endif
+#if defined(BENCH_HAVE_FIBER_ASM)
+        if (!ucontext_) bench_fiber_switch(&f->sp, main_sp_);
+#endif
+        (void)f;
+    }
+
+    static constexpr int kWaitRead = 1;
+    static constexpr int kWaitWrite = 2;
+
+    bool wait_fd(int fd, int dirs, int timeout_ms) {
+        Fiber* f = current_;
+        f->timed_out = false;
+        f->wait_fd = fd;
+        f->wait_dirs = dirs;
+        if (timeout_ms > 0) loop_->timers.add(f->timer, (uint64_t)timeout_ms, &FiberScheduler::expire, f);
+        if (dirs & kWaitRead) loop_->arm_read(fd, f->wake.h);
+        if (dirs & kWaitWrite) loop_->arm_write(fd, f->wake.h);
+        switch_out();
+        if (f->timed_out) return false;
+        loop_->timers.cancel(f->timer);
+        if (dirs == (kWaitRead | kWaitWrite)) disarm(f);
+        return true;
+    }
+
+    static void disarm(Fiber* f) {
+        if (f->wait_dirs & kWaitRead) f->sched->loop_->disarm(f->wait_fd, false);
+        if (f->wait_dirs & kWaitWrite) f->sched->loop_->disarm(f->wait_fd, true);
+    }
+
+    static void expire(void* p) {
+        auto* f = (Fiber*)p;
+        f->timed_out = true;
+        disarm(f);
+        f->wake.h.resume();
+    }
+};
+
+thread_local Fiber* FiberScheduler::t_starting_ = nullptr;
+
+static bool fibers_available() {
+#if defined(BENCH_HAVE_FIBER_ASM) || defined(BENCH_HAVE_UCONTEXT)
+    return true;
+#else
+    return false;
+#endif
+}
+
+static void cpu_fiber_job(FiberScheduler& sched, int units, int chunk, bool simd, std::atomic<uint32_t>* out) {
+    uint32_t acc = 0;
+    uint32_t lanes[kLanes] = {};
+    int done = 0;
+    while (done < units) {
+        int step = std::min(chunk, units - done);
+        if (simd) {
+            g_lanes.fn(lanes, (uint32_t)done, (uint32_t)(done + step));
+        } else {
+            for (int i = 0; i < step; i++) {
+                acc = acc * 1664525u + 1013904223u + (uint32_t)(done + i);
+            }
+        }
+        done += step;
+        sched.yield();
+    }
+    out->fetch_xor(simd ? fold_lanes(lanes) : acc, std::memory_order_relaxed);
+}
+
+// Same shape as cpu_coroutines: `concurrency` fibers in flight, each yielding
+// every chunk, and a finished fiber spawns the next task's fiber.
+static void cpu_fibers(const Config& cfg) {
+    ScopedPin pin(cfg);
+    const int chunk = 5000;
+    std::atomic<uint32_t> checksum{0};
+    FiberScheduler sched(cfg, nullptr);
+    int launched = 0;
+
+    std::function<void()> task = [&] {
+        cpu_fiber_job(sched, cfg.cpu_units, chunk, cfg.kernel == "simd", &checksum);
+        if (launched < cfg.tasks) {
+            launched++;
+            sched.spawn(task);
+        }
+    };
+    for (; launched < std::min(cfg.concurrency, cfg.tasks); launched++) sched.spawn(task);
+    sched.run();
+    (void)checksum.load();
+}
+
+// io_one_blocking with every blocking call turned into a fiber wait on the
+// scheduler's event loop.
+static void io_one_fiber(const Config& cfg, FiberScheduler& sched, const Endpoint& ep, LatencySet* lat) {
+    EventLoop* loop = sched.loop();
+    uint64_t t0 = now_ns();
+    bool pending;
+    int s = transport_connect(ep, true, 0, &pending);
+    if (s < 0) return;
+
+    if (pending) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (!sched.wait_writable(s, cfg.timeout_ms) ||
+            getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            loop->close_fd(s);
+            return;
+        }
+    }
+    lat->connect.record(now_ns() - t0);
+
+    const size_t size = msg_size(cfg);
+    std::vector<char> payload(size, 'x');
+    std::vector<char> buf(size);
+    std::vector<uint64_t> stamps((size_t)cfg.pipeline_depth);
+    PipelineWindow win{cfg.requests_per_conn, cfg.pipeline_depth, stamps.data()};
+
+    while (!win.done()) {
+        while (win.can_send()) {
+            MsgHeader h{win.next_send, (uint32_t)size};
+            win.stamp(win.next_send) = win.next_send == 0 ? t0 : now_ns();
+            size_t off = 0;
+            while (off < size) {
+                iovec iov[2];
+                msghdr mh{};
+                mh.msg_iov = iov;
+                mh.msg_iovlen = msg_iov(iov, &h, payload.data(), size, off);
+                ssize_t w = ::sendmsg(s, &mh, 0);
+                if (w > 0) { off += (size_t)w; continue; }
+                // As in io_client_task: keep reading echoes while the send is stuck.
+                if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    int r = pipeline_drain(s, buf.data(), size, win, true, lat);
+                    if (r > 0 || (r == 0 && sched.wait_either(s, cfg.timeout_ms))) continue;
+                }
+                loop->close_fd(s);
+                return;
+            }
+            win.next_send++;
+        }
+
+        int r = pipeline_drain(s, buf.data(), size, win, false, lat);
+        if (r < 0 || (r == 0 && !sched.wait_readable(s, cfg.timeout_ms))) {
+            loop->close_fd(s);
+            return;
+        }
+    }
+
+    loop->close_fd(s);
+}
+
+static void io_fibers(const Config& cfg, const Endpoint& ep, LatencySet& lat) {
+    ScopedPin pin(cfg);
+    std::unique_ptr<EventLoop> loop = make_event_loop(cfg.loop, cfg.arm == "batched");
+    FiberScheduler sched(cfg, loop.get());
+    int launched = 0;
+
+    std::function<void()> task = [&] {
+        io_one_fiber(cfg, sched, ep, &lat);
+        if (launched < cfg.tasks) {
+            launched++;
+            sched.spawn(task);
+        }
+    };
+    for (; launched < std::min(cfg.concurrency, cfg.tasks); launched++) sched.spawn(task);
+    sched.run();
+    g_loop_ctl.fetch_add((int64_t)loop->ctl_calls, std::memory_order_relaxed);
+    g_loop_wait.fetch_add((int64_t)loop->wait_calls, std::memory_order_relaxed);
+}
+
+// Fire-and-forget coroutine: runs eagerly and frees its own frame on exit.
+struct DetachedTask {
+    struct promise_type : PooledFrame {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// How the server echoes: read() into a --echo-buf-kb buffer and write() it
+// back, or (Linux) splice() socket -> pipe -> socket so the payload never
+// enters user space.
+struct ServerCompute;
+
+struct EchoOpts {
+    bool splice = false;
+    size_t bytes = 4096;
+    ServerCompute* compute = nullptr; // --server-cpu-units: parse messages and compute first
+};
+
+static void echo_copy_blocking(int c, size_t bytes) {
+    std::vector<char> buf(bytes);
+    while (true) {
+        ssize_t n = ::read(c, buf.data(), buf.size());
+        if (n <= 0) break;
+        ssize_t off = 0;
+        while (off < n) {
+            ssize_t w = ::write(c, buf.data() + off, (size_t)(n - off));
+            if (w <= 0) return;
+            off += w;
+        }
+    }
+}
+
+static DetachedTask reactor_conn(EventLoop* loop, int c, size_t bytes) {
+    std::vector<char> buf(bytes);
+    while (true) {
+        ssize_t n = ::read(c, buf.data(), buf.size());
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                co_await FdReadable{loop, c};
+                continue;
+            }
+            if (errno == EINTR) continue;
+            break;
+        }
+        ssize_t off = 0;
+        while (off < n) {
+            ssize_t w = ::write(c, buf.data() + off, (size_t)(n - off));
+            if (w > 0) { off += w; continue; }
+            if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                co_await FdWritable{loop, c};
+                continue;
+            }
+            loop->close_fd(c);
+            co_return;
+        }
+    }
+    loop->close_fd(c);
+}
+
+#if defined(__linux__)
+// The pipe between the two splices holds one buffer's worth; if
+// F_SETPIPE_SZ is refused it keeps the default 64 KiB.
+static bool open_splice_pipe(int p[2], size_t bytes, bool nonblocking) {
+    if (::pipe2(p, nonblocking ? O_NONBLOCK : 0) < 0) return false;
+    (void)::fcntl(p[1], F_SETPIPE_SZ, (int)bytes);
+    return true;
+}
+
+static void echo_splice_blocking(int c, size_t bytes) {
+    int p[2];
+    if (!open_splice_pipe(p, bytes, false)) return;
+    bool ok = true;
+    while (ok) {
+        ssize_t n = ::splice(c, nullptr, p[1], nullptr, bytes, SPLICE_F_MOVE);
+        if (n <= 0) break;
+        while (n > 0) {
+            ssize_t w = ::splice(p[0], nullptr, c, nullptr, (size_t)n, SPLICE_F_MOVE);
+            if (w <= 0) { ok = false; break; }
+            n -= w;
+        }
+    }
+    ::close(p[0]);
+    ::close(p[1]);
+}
+
+// The pipe is drained before every read, so EAGAIN from the first splice
+// always means the socket is empty.
+static DetachedTask reactor_splice(EventLoop* loop, int c, size_t bytes) {
+    int p[2];
+    if (!open_splice_pipe(p, bytes, true)) {
+        loop->close_fd(c);
+        co_return;
+    }
+    bool ok = true;
+    while (ok) {
+        ssize_t n = ::splice(c, nullptr, p[1], nullptr, bytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EAGAIN) {
+                co_await FdReadable{loop, c};
+                continue;
+            }
+            if (errno == EINTR) continue;
+            break;
+        }
+        while (n > 0) {
+            ssize_t w = ::splice(p[0], nullptr, c, nullptr, (size_t)n, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (w > 0) { n -= w; continue; }
+            if (w < 0 && errno == EAGAIN) {
+                co_await FdWritable{loop, c};
+                continue;
+            }
+            if (w < 0 && errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+    }
+    ::close(p[0]);
+    ::close(p[1]);
+    loop->close_fd(c);
+}
+#endif
+
+// ---- Compute server ----
+//
+// With --server-cpu-units the echo server frames the stream into messages
+// (MsgHeader.len bytes each) and runs cpu_work on every one before echoing
+// it. On a reactor that work can run inline, holding up every other
+// connection on the thread; be posted to a compute pool as a plain function
+// whose completion is posted back; or be done by the handler coroutine
+// itself after hopping onto the pool, in 5000-unit slices that go to the back
+// of the queue in between, and hopping back to its loop to write.
+
+struct ServerCompute {
+    enum Mode { kInline, kPool, kCoroutines };
+    int units = 0;
+    Mode mode = kInline;
+    ThreadPool* pool = nullptr;
+    std::atomic<uint32_t> sink{0}; // keeps the work observable
+};
+
+// Hands coroutines back to a reactor from other threads. The byte is only
+// written when the queue was empty; inbox_drain reads the pipe dry before
+// taking the queue, so a post can't slip between the two unnoticed.
+struct LoopInbox {
+    int pipe[2] = {-1, -1};
+    std::mutex m;
+    std::vector<std::coroutine_handle<>> queue;
+
+    void post(std::coroutine_handle<> h) {
+        std::lock_guard<std::mutex> lk(m);
+        queue.push_back(h);
+        if (queue.size() == 1) {
+            char b = 1;
+            (void)::write(pipe[1], &b, 1);
+        }
+    }
+};
+
+static IoTask inbox_drain(EventLoop* loop, LoopInbox* inbox) {
+    std::vector<std::coroutine_handle<>> batch;
+    while (true) {
+        co_await FdReadable{loop, inbox->pipe[0]};
+        char b[64];
+        while (::read(inbox->pipe[0], b, sizeof(b)) > 0) {}
+        {
+            std::lock_guard<std::mutex> lk(inbox->m);
+            batch.swap(inbox->queue);
+        }
+        for (auto h : batch) h.resume();
+        batch.clear();
+    }
+}
+
+// The handler waits on the loop while a pool worker runs cpu_work and posts
+// the handler back.
+struct PoolOffload {
+    ServerCompute* sc;
+    LoopInbox* inbox;
+    std::coroutine_handle<> h{};
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> awaiting) {
+        h = awaiting;
+        sc->pool->post([](void* p, int, int) {
+            auto* self = (PoolOffload*)p;
+            self->sc->sink.fetch_xor(cpu_work(self->sc->units), std::memory_order_relaxed);
+            // Once posted the handler may resume and end *self.
+            LoopInbox* inbox = self->inbox;
+            inbox->post(self->h);
+        }, this);
+    }
+    void await_resume() const noexcept {}
+};
+
+struct ResumeOnPool {
+    ThreadPool* pool;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        pool->post([](void* a, int, int) { std::coroutine_handle<>::from_address(a).resume(); }, h.address());
+    }
+    void await_resume() const noexcept {}
+};
+
+struct ResumeOnLoop {
+    LoopInbox* inbox;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { inbox->post(h); }
+    void await_resume() const noexcept {}
+};
+
+// Bytes in the message at the front of buf once its header is in; 0 for a
+// header that can't be one of ours.
+static size_t framed_len(const char* buf) {
+    MsgHeader h;
+    std::memcpy(&h, buf, sizeof(h));
+    size_t len = std::max((size_t)h.len, sizeof(MsgHeader));
+    return len > (64u << 20) ? 0 : len;
+}
+
+static void echo_compute_blocking(int c, ServerCompute& sc) {
+    std::vector<char> buf(4096);
+    size_t have = 0;
+    while (true) {
+        size_t len = have >= sizeof(MsgHeader) ? framed_len(buf.data()) : 0;
+        if (have >= sizeof(MsgHeader) && len == 0) return;
+        if (len && have >= len) {
+            sc.sink.fetch_xor(cpu_work(sc.units), std::memory_order_relaxed);
+            for (size_t off = 0; off < len;) {
+                ssize_t w = ::write(c, buf.data() + off, len - off);
+                if (w <= 0) return;
+                off += (size_t)w;
+            }
+            std::memmove(buf.data(), buf.data() + len, have - len);
+            have -= len;
+            continue;
+        }
+        if (len > buf.size()) buf.resize(len);
+        ssize_t n = ::read(c, buf.data() + have, buf.size() - have);
+        if (n <= 0) return;
+        have += (size_t)n;
+    }
+}
+
+static DetachedTask reactor_compute(EventLoop* loop, int c, ServerCompute* sc, LoopInbox* inbox) {
+    std::vector<char> buf(4096);
+    size_t have = 0;
+    while (true) {
+        size_t len = have >= sizeof(MsgHeader) ? framed_len(buf.data()) : 0;
+        if (have >= sizeof(MsgHeader) && len == 0) break;
+        if (len && have >= len) {
+            if (sc->mode == ServerCompute::kInline) {
+                sc->sink.fetch_xor(cpu_work(sc->units), std::memory_order_relaxed);
+            } else if (sc->mode == ServerCompute::kPool) {
+                co_await PoolOffload{sc, inbox};
+            } else {
+                co_await ResumeOnPool{sc->pool};
+                uint32_t acc = 0;
+                for (int done = 0; done < sc->units; done += 5000) {
+                    if (done) co_await ResumeOnPool{sc->pool};
+                    acc ^= cpu_work(std::min(5000, sc->units - done));
+                }
+                sc->sink.fetch_xor(acc, std::memory_order_relaxed);
+                co_await ResumeOnLoop{inbox};
+            }
+            size_t off = 0;
+            while (off < len) {
+                ssize_t w = ::write(c, buf.data() + off, len - off);
+                if (w > 0) { off += (size_t)w; continue; }
+                if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    co_await FdWritable{loop, c};
+                    continue;
+                }
+                loop->close_fd(c);
+                co_return;
+            }
+            std::memmove(buf.data(), buf.data() + len, have - len);
+            have -= len;
+            continue;
+        }
+        if (len > buf.size()) buf.resize(len);
+        ssize_t n = ::read(c, buf.data() + have, buf.size() - have);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                co_await FdReadable{loop, c};
+                continue;
+            }
+            if (errno == EINTR) continue;
+            break;
+        }
+        have += (size_t)n;
+    }
+    loop->close_fd(c);
+}
+
+static void echo_blocking(int c, const EchoOpts& opts) {
+    if (opts.compute) return echo_compute_blocking(c, *opts.compute);
+#if defined(__linux__)
+    if (opts.splice) return echo_splice_blocking(c, opts.bytes);
+#endif
+    echo_copy_blocking(c, opts.bytes);
+}
+
+static void reactor_echo(EventLoop* loop, int c, const EchoOpts& opts, LoopInbox* inbox) {
+    if (opts.compute) {
+        reactor_compute(loop, c, opts.compute, inbox);
+        return;
+    }
+#if defined(__linux__)
+    if (opts.splice) {
+        reactor_splice(loop, c, opts.bytes);
+        return;
+    }
+#endif
+    reactor_conn(loop, c, opts.bytes);
+}
+
+// Accepts until EAGAIN (the loop is edge-triggered) and spawns a connection
+// coroutine on the same reactor for each client.
+static IoTask reactor_accept(EventLoop* loop, int listen_fd, const Endpoint* ep, const EchoOpts* opts,
+                             LoopInbox* inbox) {
+    while (true) {
+        int c = transport_accept(listen_fd, *ep);
+        if (c >= 0) {
+            if (set_nonblocking(c) < 0) { ::close(c); continue; }
+            reactor_echo(loop, c, *opts, inbox);
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            co_await FdReadable{loop, listen_fd};
+            continue;
+        }
+        if (errno == EINTR || errno == ECONNABORTED) continue;
+        co_return;
+    }
+}
+
+static IoTask reactor_wakeup(EventLoop* loop, int fd, std::atomic<int>* running) {
+    co_await FdReadable{loop, fd};
+    running->store(0, std::memory_order_release);
+}
+
+// One reactor thread of the event-driven server: its own EventLoop, its own
+// listener (or a shared one) and a self-pipe that stop() uses to wake it.
+struct Reactor {
+    std::unique_ptr<EventLoop> loop;
+    int listen_fd = -1;
+    bool owns_listener = false;
+    int wake[2] = {-1, -1};
+    std::atomic<int> running{1};
+    std::optional<IoTask> acceptor;
+    std::optional<IoTask> waker;
+    LoopInbox inbox;
+    std::optional<IoTask> drainer;
+    std::thread th;
+};
+
+struct EchoServer {
+    int listen_fd = -1;
+    Endpoint endpoint{};
+    EchoOpts echo{};
+    ServerCompute compute;
+    Config compute_cfg;      // pins the compute pool to --server-cpus
+    std::unique_ptr<ThreadPool> compute_pool;
+    std::thread accept_thread;
+    std::vector<std::unique_ptr<Reactor>> reactors;
+
+    bool start(const Config& cfg) {
+        echo = EchoOpts{cfg.echo == "splice", (size_t)cfg.echo_buf_kb << 10};
+        if (cfg.server_cpu_units > 0) {
+            compute.units = cfg.server_cpu_units;
+            compute.mode = cfg.server_compute == "pool"       ? ServerCompute::kPool
+                         : cfg.server_compute == "coroutines" ? ServerCompute::kCoroutines
+                                                              : ServerCompute::kInline;
+            if (compute.mode != ServerCompute::kInline) {
+                compute_cfg = cfg;
+                compute_cfg.client_cpus = cfg.server_cpu_set;
+                int n = cfg.compute_threads;
+                if (n < 1) n = (int)std::max(1u, std::thread::hardware_concurrency());
+                compute_pool = std::make_unique<ThreadPool>(compute_cfg, n);
+                compute.pool = compute_pool.get();
+            }
+            echo.compute = &compute;
+        }
+        if (cfg.server == "threads") return start_threads(cfg);
+        if (cfg.server == "reactor") return start_reactors(cfg);
+        std::cerr << "Unknown server mode '" << cfg.server << "'\n";
+        return false;
+    }
+
+    void stop() {
+        for (auto& r : reactors) {
+            char b = 1;
+            (void)::write(r->wake[1], &b, 1);
+        }
+        for (auto& r : reactors) {
+            if (r->th.joinable()) r->th.join();
+        }
+        // Jobs still on the compute pool post back into the reactors'
+        // inboxes, so the pool is drained while those are still intact.
+        compute_pool.reset();
+        for (auto& r : reactors) {
+            r->acceptor.reset();
+            r->waker.reset();
+            r->drainer.reset();
+            if (r->owns_listener) ::close(r->listen_fd);
+            ::close(r->wake[0]);
+            ::close(r->wake[1]);
+            ::close(r->inbox.pipe[0]);
+            ::close(r->inbox.pipe[1]);
+        }
+        reactors.clear();
+
+        if (listen_fd >= 0) {
+            // close() alone does not wake a blocked accept() on Linux.
+            ::shutdown(listen_fd, SHUT_RDWR);
+            ::close(listen_fd);
+            listen_fd = -1;
+        }
+        if (accept_thread.joinable()) accept_thread.join();
+        transport_unlink(endpoint);
+    }
+
+private:
+    // Connection threads inherit the accept thread's --server-cpus mask.
+    bool start_threads(const Config& cfg) {
+        listen_fd = transport_listen(cfg, &endpoint, 0, false);
+        if (listen_fd < 0) return false;
+
+        // The fd is captured by value: stop() resets listen_fd while this
+        // thread may still be blocked in accept().
+        accept_thread = std::thread([fd = listen_fd, ep = endpoint, opts = echo, cpus = cfg.server_cpu_set, numa = cfg.numa == "local"] {
+#if defined(__linux__)
+            if (!cpus.empty()) pin_thread(cpus, numa);
+#else
+            (void)cpus;
+            (void)numa;
+#endif
+            while (true) {
+                int c = transport_accept(fd, ep);
+                if (c < 0 && errno == EINTR) continue;
+                if (c < 0) break;
+
+                std::thread([c, opts] {
+                    echo_blocking(c, opts);
+                    ::close(c);
+                }).detach();
+            }
+        });
+
+        return true;
+    }
+
+    // Linux balances TCP connections across SO_REUSEPORT listeners, so every
+    // reactor gets its own. Elsewhere, and for Unix/socketpair transports,
+    // all reactors watch one shared non-blocking listener and whoever loses
+    // the accept() race sees EAGAIN.
+    // Connections are expected to be closed by their clients before stop().
+    bool start_reactors(const Config& cfg) {
+#if defined(__linux__) && defined(SO_REUSEPORT)
+        const bool per_reactor = cfg.transport == "tcp" || cfg.transport == "tcp6";
+#else
+        const bool per_reactor = false;
+#endif
+        int n = cfg.server_threads;
+        if (n < 1) n = (int)std::max(1u, std::thread::hardware_concurrency());
+
+        int shared = -1;
+        if (!per_reactor) {
+            shared = transport_listen(cfg, &endpoint, 0, false);
+            if (shared < 0 || set_nonblocking(shared) < 0) return false;
+        }
+
+        for (int i = 0; i < n; i++) {
+            auto r = std::make_unique<Reactor>();
+            if (per_reactor) {
+                uint16_t port = i == 0 ? 0 : endpoint_port(endpoint);
+                r->listen_fd = transport_listen(cfg, &endpoint, port, true);
+                r->owns_listener = true;
+                if (r->listen_fd < 0 || set_nonblocking(r->listen_fd) < 0) return false;
+            } else {
+                r->listen_fd = shared;
+                r->owns_listener = i == 0;
+            }
+            if (::pipe(r->wake) < 0 || set_nonblocking(r->wake[0]) < 0) return false;
+            if (::pipe(r->inbox.pipe) < 0 || set_nonblocking(r->inbox.pipe[0]) < 0 ||
+                set_nonblocking(r->inbox.pipe[1]) < 0) {
+                return false;
+            }
+
+            r->loop = make_event_loop(cfg.loop, cfg.arm == "batched");
+            r->acceptor.emplace(reactor_accept(r->loop.get(), r->listen_fd, &endpoint, &echo, &r->inbox));
+            r->acceptor->start(r->loop.get(), nullptr);
+            r->waker.emplace(reactor_wakeup(r->loop.get(), r->wake[0], &r->running));
+            r->waker->start(r->loop.get(), nullptr);
+            r->drainer.emplace(inbox_drain(r->loop.get(), &r->inbox));
+            r->drainer->start(r->loop.get(), nullptr);
+
+            Reactor* rp = r.get();
+            int cpu = cfg.server_cpu_set.empty() ? -1 : cfg.server_cpu_set[(size_t)i % cfg.server_cpu_set.size()];
+            bool numa = cfg.numa == "local";
+            r->th = std::thread([rp, cpu, numa] {
+#if defined(__linux__)
+                if (cpu >= 0) pin_thread({cpu}, numa);
+#else
+                (void)cpu;
+                (void)numa;
+#endif
+                rp->loop->run_until(rp->running);
+            });
+            reactors.push_back(std::move(r));
+        }
+        return true;
+    }
+};
+
+#if defined(BENCH_HAVE_IO_URING)
+// Completion-based loop over a raw io_uring instance. Operations are queued
+// as SQEs and submitted in one io_uring_enter() per loop iteration, together
+// with the wait for completions; each CQE resumes the coroutine that queued it.
+class UringLoop {
+public:
+    explicit UringLoop(unsigned entries) {
+        io_uring_params p{};
+        fd_ = (int)::syscall(__NR_io_uring_setup, entries, &p);
+        if (fd_ < 0) {
+            std::perror("io_uring_setup");
+            std::exit(1);
+        }
+
+        sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+
+        sq_ring_ = map(sq_len_, IORING_OFF_SQ_RING);
+        cq_ring_ = single ? sq_ring_ : map(cq_len_, IORING_OFF_CQ_RING);
+        sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = (io_uring_sqe*)map(sqes_len_, IORING_OFF_SQES);
+
+        char* sq = (char*)sq_ring_;
+        sq_head_ = (unsigned*)(sq + p.sq_off.head);
+        sq_tail_ = (unsigned*)(sq + p.sq_off.tail);
+        sq_mask_ = *(unsigned*)(sq + p.sq_off.ring_mask);
+        sq_array_ = (unsigned*)(sq + p.sq_off.array);
+        sq_entries_ = p.sq_entries;
+        local_tail_ = *sq_tail_;
+
+        char* cq = (char*)cq_ring_;
+        cq_head_ = (unsigned*)(cq + p.cq_off.head);
+        cq_tail_ = (unsigned*)(cq + p.cq_off.tail);
+        cq_mask_ = *(unsigned*)(cq + p.cq_off.ring_mask);
+        cqes_ = (io_uring_cqe*)(cq + p.cq_off.cqes);
+    }
+
+    ~UringLoop() {
+        ::munmap(sqes_, sqes_len_);
+        if (cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_len_);
+        ::munmap(sq_ring_, sq_len_);
+        ::close(fd_);
+    }
+
+    // Returns a zeroed SQE. It is handed to the kernel on the next enter().
+    // `room` is how many SQEs the caller is about to take in a row: a linked
+    // pair must not be split across two submissions.
+    io_uring_sqe* get_sqe(unsigned room = 1) {
+        if (local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + room > sq_entries_) {
+            enter(0, 0);
+        }
+        unsigned idx = local_tail_ & sq_mask_;
+        sq_array_[idx] = idx;
+        local_tail_++;
+        io_uring_sqe* sqe = &sqes_[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    void run_until(std::atomic<int>& pending) {
+        while (pending.load(std::memory_order_acquire) > 0) {
+            enter(1, IORING_ENTER_GETEVENTS);
+
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            while (head != tail) {
+                io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+                auto* op = (Completion*)(uintptr_t)cqe->user_data;
+                head++;
+                __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+                if (!op) continue;
+                op->res = cqe->res;
+                op->h.resume();
+            }
+        }
+    }
+
+    static bool supported() {
+        io_uring_params p{};
+        int fd = (int)::syscall(__NR_io_uring_setup, 1, &p);
+        if (fd < 0) return false;
+        ::close(fd);
+        return true;
+    }
+
+    // Lives inside the awaiting coroutine's frame; user_data points at it.
+    struct Completion {
+        std::coroutine_handle<> h{};
+        int res = 0;
+    };
+
+private:
+    void* map(size_t len, off_t off) {
+        void* p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, off);
+        if (p == MAP_FAILED) {
+            std::perror("io_uring mmap");
+            std::exit(1);
+        }
+        return p;
+    }
+
+    void enter(unsigned min_complete, unsigned flags) {
+        unsigned to_submit = local_tail_ - *sq_tail_;
+        __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+        while (true) {
+            long rc = ::syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, nullptr, 0);
+            if (rc >= 0) return;
+            if (errno == EINTR) continue;
+            std::perror("io_uring_enter");
+            std::exit(1);
+        }
+    }
+
+    int fd_;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_len_ = 0, cq_len_ = 0, sqes_len_ = 0;
+
+    io_uring_sqe* sqes_ = nullptr;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned local_tail_ = 0;
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+// With timeout_ms > 0 the op is linked to an IORING_OP_LINK_TIMEOUT, so a
+// stalled peer completes it with -ECANCELED like the event loops' with_timeout
+// deadlines; the timeout's own CQE carries no user_data and is skipped.
+struct UringOp {
+    UringLoop* ring;
+    uint8_t opcode;
+    int fd;
+    const void* addr;
+    unsigned len;
+    uint64_t off;
+    int timeout_ms = 0;
+    UringLoop::Completion c{};
+    __kernel_timespec ts{};
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        c.h = h;
+        io_uring_sqe* sqe = ring->get_sqe(timeout_ms > 0 ? 2 : 1);
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)(uintptr_t)addr;
+        sqe->len = len;
+        sqe->off = off;
+        sqe->user_data = (uint64_t)(uintptr_t)&c;
+        if (timeout_ms <= 0) return;
+        sqe->flags |= IOSQE_IO_LINK;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        io_uring_sqe* link = ring->get_sqe();
+        link->opcode = IORING_OP_LINK_TIMEOUT;
+        link->fd = -1;
+        link->addr = (uint64_t)(uintptr_t)&ts;
+        link->len = 1;
+    }
+    int await_resume() const noexcept { return c.res; }
+};
+
+static UringOp uring_connect(UringLoop* ring, int fd, const sockaddr* sa, socklen_t len, int timeout_ms) {
+    return UringOp{ring, IORING_OP_CONNECT, fd, sa, 0, (uint64_t)len, timeout_ms};
+}
+static UringOp uring_sendmsg(UringLoop* ring, int fd, const msghdr* mh, int timeout_ms) {
+    return UringOp{ring, IORING_OP_SENDMSG, fd, mh, 1, 0, timeout_ms};
+}
+static UringOp uring_recv(UringLoop* ring, int fd, void* buf, size_t len, int timeout_ms) {
+    return UringOp{ring, IORING_OP_RECV, fd, buf, (unsigned)len, 0, timeout_ms};
+}
+
+// socketpair has nothing to connect asynchronously; it goes through
+// transport_connect like the blocking clients. Every op has a timeout_ms
+// deadline; an op that fails or times out (-ECANCELED) drops the connection.
+static IoTask io_client_task_uring(UringLoop* ring, const Endpoint* ep, const char* payload, char* buf, size_t size,
+                                   int requests, int depth, LatencySet* lat, int timeout_ms) {
+    uint64_t t0 = now_ns();
+    int s;
+    if (ep->pair) {
+        bool pending;
+        s = transport_connect(*ep, false, 0, &pending);
+        if (s < 0) co_return;
+    } else {
+        s = ::socket(ep->family, SOCK_STREAM, 0);
+        if (s < 0) co_return;
+        set_nodelay(s, *ep);
+        if (co_await uring_connect(ring, s, (const sockaddr*)&ep->addr, ep->len, timeout_ms) < 0) {
+            ::close(s);
+            co_return;
+        }
+    }
+    lat->connect.record(now_ns() - t0);
+
+    PipelineWindow win{requests, fitting_depth(s, depth, size, lat), (uint64_t*)(buf + slot_msg_bytes(size))};
+
+    while (!win.done()) {
+        while (win.can_send()) {
+            MsgHeader h{win.next_send, (uint32_t)size};
+            win.stamp(win.next_send) = win.next_send == 0 ? t0 : now_ns();
+            size_t off = 0;
+            while (off < size) {
+                iovec iov[2];
+                msghdr mh{};
+                mh.msg_iov = iov;
+                mh.msg_iovlen = msg_iov(iov, &h, payload, size, off);
+                int w = co_await uring_sendmsg(ring, s, &mh, timeout_ms);
+                if (w <= 0) { ::close(s); co_return; }
+                off += (size_t)w;
+            }
+            win.next_send++;
+        }
+
+        size_t got = 0;
+        uint64_t t_first = 0;
+        while (got < size) {
+            int n = co_await uring_recv(ring, s, buf + got, size - got, timeout_ms);
+            if (n <= 0) { ::close(s); co_return; }
+            if (got == 0) t_first = now_ns();
+            got += (size_t)n;
+        }
+
+        MsgHeader h;
+        std::memcpy(&h, buf, sizeof(h));
+        if (h.seq != win.next_recv) { ::close(s); co_return; }
+        uint64_t t_req = win.stamp(h.seq);
+        lat->first_byte.record(t_first - t_req);
+        lat->total.record(now_ns() - t_req);
+        win.next_recv++;
+    }
+
+    ::close(s);
+    co_return;
+}
+
+static void io_coroutines_uring(const Config& cfg, const Endpoint& ep, LatencySet& lat) {
+    ScopedPin pin(cfg);
+    // Two SQEs per in-flight client: each task has a single op queued, linked
+    // to its timeout.
+    unsigned entries = (unsigned)std::min(2 * cfg.concurrency, 32768);
+    UringLoop ring(entries);
+    const std::vector<char> payload(msg_size(cfg), 'x');
+    IoAdmission admission(cfg, nullptr, slot_buf_bytes(cfg), [&](char* buf, uint64_t) {
+        return io_client_task_uring(&ring, &ep, payload.data(), buf, payload.size(),
+                                    cfg.requests_per_conn, cfg.pipeline_depth, &lat, cfg.timeout_ms);
+    });
+    admission.start();
+    ring.run_until(admission.pending);
+}
+#endif
+
+// Runs fn once in a forked child, so a model that runs out of memory,
+// threads or processes cannot take the benchmark down with it. Returns how
+// far the child's RSS rose, plus one grandchild's RSS per in-flight task for
+// the fork models, in KiB; -1 if the child failed.
+template <class Fn>
+static int64_t footprint_kb(int inflight, Fn fn) {
+    int fds[2];
+    if (::pipe(fds) < 0) return -1;
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        ::close(fds[0]);
+        g_child_peak_kb = 0;
+        reset_peak_rss();
+        int64_t rss0 = current_rss_kb();
+        fn();
+        int64_t kb = std::max<int64_t>(peak_rss_kb() - rss0, 0) + g_child_peak_kb * inflight;
+        (void)::write(fds[1], &kb, sizeof(kb));
+        _exit(0);
+    }
+    ::close(fds[1]);
+    int64_t kb = -1;
+    if (::read(fds[0], &kb, sizeof(kb)) != (ssize_t)sizeof(kb)) kb = -1;
+    ::close(fds[0]);
+    int status = 0;
+    (void)::waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+    return kb;
+}
+
+// --mem-budget-mb: doubles concurrency (with tasks == concurrency, so every
+// task is meant to be alive at once) from --concurrency up to --sweep-max and
+// reports the largest step each model ran within the budget. I/O models also
+// stop before the fd limit, since every connection costs an fd here and one
+// in the server.
+static void run_memory_sweep(const Config& cfg, const Endpoint& ep) {
+    struct Model {
+        std::string name;
+        bool io;
+        std::function<void(const Config&)> run;
+    };
+    std::vector<Model> models = {
+        {"threads (cpu)", false, [](const Config& c) { cpu_threads(c); }},
+        {"pool (cpu)", false, [](const Config& c) { ThreadPool pool(c, c.concurrency); cpu_pool(c, pool); }},
+        {"processes (cpu)", false, [](const Config& c) { cpu_processes(c); }},
+        {"coroutines (cpu)", false, [](const Config& c) { cpu_coroutines(c, *std::make_unique<LatencySet>()); }},
+        {"coroutines_mt (cpu)", false, [](const Config& c) { cpu_coroutines_mt(c); }},
+        {"threads (io)", true, [ep](const Config& c) { io_threads(c, ep, *std::make_unique<LatencySet>()); }},
+        {"processes (io)", true, [ep](const Config& c) { io_processes(c, ep, *std::make_unique<LatencySet>()); }},
+        {"coroutines (io)", true, [ep](const Config& c) { io_coroutines(c, ep, *std::make_unique<LatencySet>()); }},
+    };
+#if defined(BENCH_HAVE_IO_URING)
+    if (UringLoop::supported()) {
+        models.push_back({"io_uring (io)", true, [ep](const Config& c) {
+            io_coroutines_uring(c, ep, *std::make_unique<LatencySet>());
+        }});
+    }
+#endif
+
+    rlimit nofile{};
+    (void)::getrlimit(RLIMIT_NOFILE, &nofile);
+    const int64_t budget_kb = (int64_t)cfg.mem_budget_mb * 1024;
+
+    std::cout << "| Model | Max concurrency | Footprint | Per task | Stopped by |\n";
+    std::cout << "|------:|----------------:|----------:|---------:|-----------:|\n";
+    for (const auto& m : models) {
+        int best = 0;
+        int64_t best_kb = 0;
+        std::string stop = "sweep max";
+        for (int c = cfg.concurrency;; c = (int)std::min<int64_t>((int64_t)c * 2, cfg.sweep_max)) {
+            if (m.io && (rlim_t)c + 64 > nofile.rlim_cur) {
+                stop = "fd limit";
+                break;
             }
-        });
+            Config step = cfg;
+            step.concurrency = c;
+            step.tasks = c;
+            int64_t kb = footprint_kb(c, [&] { m.run(step); });
+            if (kb < 0) {
+                stop = "failed";
+                break;
+            }
+            if (kb > budget_kb) {
+                stop = "budget";
+                break;
+            }
+            best = c;
+            best_kb = kb;
+            if (c == cfg.sweep_max) break;
+        }
+        std::cout << "| " << m.name
+                  << " | " << (best ? std::to_string(best) : "-")
+                  << " | " << (best ? fmt_kb((double)best_kb) : "-")
+                  << " | " << (best ? fmt_kb((double)best_kb / best) : "-")
+                  << " | " << stop
+                  << " |\n";
     }
-    for (auto& th : workers) th.join();
+    std::cout << "\n";
 }
 
-static void io_processes(const Config& cfg, uint16_t port) {
+extern char** environ;
+
+enum class SpawnKind { Fork, Vfork, ForkExec, PosixSpawn, CloneVm };
+
+// Out of line so the child, which borrows the parent's stack until it exits,
+// can't clobber spawn_bench's locals.
+__attribute__((noinline)) static pid_t spawn_vfork() {
+    pid_t pid = ::vfork();
+    if (pid == 0) _exit(0);
+    return pid;
+}
+
+#if defined(__linux__)
+static int clone_vm_child(void*) { return 0; }
+#endif
+
+// Spawns spawn_tasks children with up to `concurrency` alive at once (vfork
+// suspends the parent, so it is always one at a time). fork, vfork and
+// clone_vm children _exit immediately; fork_exec and posix_spawn run
+// --spawn-exec, so those two compare like for like.
+static void spawn_bench(const Config& cfg, SpawnKind kind, LatencySet& lat) {
+    constexpr size_t kCloneStack = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> stacks;
+    std::vector<char*> free_stacks;
+    std::unordered_map<pid_t, std::pair<uint64_t, char*>> alive;
+
+    char* const argv[] = {(char*)cfg.spawn_exec.c_str(), nullptr};
     int launched = 0;
     int completed = 0;
 
-    while (completed < cfg.tasks) {
-        while (launched - completed < cfg.concurrency && launched < cfg.tasks) {
-            pid_t pid = ::fork();
-            if (pid == 0) {
-                io_one_blocking(port, cfg.payload_size, cfg.timeout_ms);
-                _exit(0);
+    while (completed < cfg.spawn_tasks) {
+        while (launched - completed < cfg.concurrency && launched < cfg.spawn_tasks) {
+            char* stack = nullptr;
+            uint64_t t0 = now_ns();
+            pid_t pid = -1;
+            switch (kind) {
+            case SpawnKind::Fork:
+                pid = ::fork();
+                if (pid == 0) _exit(0);
+                break;
+            case SpawnKind::Vfork:
+                pid = spawn_vfork();
+                break;
+            case SpawnKind::ForkExec:
+                pid = ::fork();
+                if (pid == 0) {
+                    ::execv(argv[0], argv);
+                    _exit(127);
+                }
+                break;
+            case SpawnKind::PosixSpawn:
+                if (::posix_spawn(&pid, argv[0], nullptr, nullptr, argv, environ) != 0) pid = -1;
+                break;
+            case SpawnKind::CloneVm:
+#if defined(__linux__)
+                if (free_stacks.empty()) {
+                    stacks.push_back(std::make_unique<char[]>(kCloneStack));
+                    free_stacks.push_back(stacks.back().get());
+                }
+                stack = free_stacks.back();
+                free_stacks.pop_back();
+                pid = ::clone(clone_vm_child, stack + kCloneStack, CLONE_VM | SIGCHLD, nullptr);
+                if (pid < 0) free_stacks.push_back(stack);
+#endif
+                break;
+            }
+            if (pid < 0) {
+                std::perror("spawn");
+                std::exit(1);
             }
+            lat.connect.record(now_ns() - t0);
+            alive[pid] = {t0, stack};
             launched++;
         }
+
         int status = 0;
-        (void)::wait(&status);
+        pid_t pid = ::waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            std::perror("waitpid");
+            std::exit(1);
+        }
+        auto it = alive.find(pid);
+        if (it == alive.end()) continue;
+        lat.total.record(now_ns() - it->second.first);
+        if (it->second.second) free_stacks.push_back(it->second.second);
+        alive.erase(it);
         completed++;
     }
 }
 
+// ---- Distributed runs ----
+//
+// --server-only runs just the echo server on --bind until SIGINT/SIGTERM, and
+// --client points the I/O suites at it with --target instead of starting a
+// server of its own. Clients started with --join (on any number of hosts)
+// meet at the coordinator's barrier before every row, so they start the row
+// together, and send back its Result. The coordinator merges each row over
+// all --clients and prints and records it as a local run would. The protocol
+// is one text line per message: HELLO host, READY suite model, GO,
+// RESULT {json}, DONE.
 
-class KqueueLoop {
-public:
-    KqueueLoop() {
-        kq_ = ::kqueue();
-        if (kq_ < 0) {
-            std::perror("kqueue");
-            std::exit(1);
+// A blocking TCP connection, read and written a line at a time.
+struct LineConn {
+    int fd = -1;
+    std::string buf;
+
+    bool read_line(std::string* line) {
+        while (true) {
+            size_t nl = buf.find('\n');
+            if (nl != std::string::npos) {
+                *line = buf.substr(0, nl);
+                buf.erase(0, nl + 1);
+                return true;
+            }
+            char chunk[4096];
+            ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buf.append(chunk, (size_t)n);
         }
     }
-    ~KqueueLoop() { ::close(kq_); }
 
-    void arm_read(int fd, std::coroutine_handle<> h) {
-        struct kevent kev{};
-        EV_SET(&kev, fd, EVFILT_READ, EV_ADD | EV_ONESHOT, 0, 0, (void*)h.address());
-        if (::kevent(kq_, &kev, 1, nullptr, 0, nullptr) < 0) {
-            std::perror("kevent arm_read");
-            std::exit(1);
+    bool send_line(const std::string& line) {
+        const std::string out = line + "\n";
+        for (size_t off = 0; off < out.size();) {
+            ssize_t w = ::send(fd, out.data() + off, out.size() - off, kSendNoSignal);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return false;
+            off += (size_t)w;
         }
+        return true;
     }
-    void arm_write(int fd, std::coroutine_handle<> h) {
-        struct kevent kev{};
-        EV_SET(&kev, fd, EVFILT_WRITE, EV_ADD | EV_ONESHOT, 0, 0, (void*)h.address());
-        if (::kevent(kq_, &kev, 1, nullptr, 0, nullptr) < 0) {
-            std::perror("kevent arm_write");
-            std::exit(1);
-        }
+};
+
+// Histograms travel as their non-empty buckets, so merged percentiles are
+// exact rather than averages of per-client percentiles.
+static void write_wire_histogram(std::ostream& out, const Histogram& h) {
+    out << "{\"max\": " << h.max << ", \"buckets\": [";
+    const char* sep = "";
+    for (int i = 0; i < Histogram::kBuckets; i++) {
+        if (!h.counts[i]) continue;
+        out << sep << "[" << i << ", " << h.counts[i] << "]";
+        sep = ", ";
+    }
+    out << "]}";
+}
+
+static bool read_wire_histogram(const Json* j, Histogram* h) {
+    *h = Histogram{};
+    const Json* max = j ? j->get("max") : nullptr;
+    const Json* buckets = j ? j->get("buckets") : nullptr;
+    if (!max || !buckets) return false;
+    for (const auto& b : buckets->items) {
+        if (b.items.size() != 2) return false;
+        int idx = (int)b.items[0].num;
+        if (idx < 0 || idx >= Histogram::kBuckets) return false;
+        h->counts[idx] += (uint64_t)b.items[1].num;
+        h->count += (uint64_t)b.items[1].num;
     }
+    h->max = (uint64_t)max->num;
+    return true;
+}
 
-    void run_until(std::atomic<int>& pending) {
-        constexpr int MAXEV = 256;
-        struct kevent evs[MAXEV];
+// Counters and memory go as arrays, in field order.
+static std::string result_to_wire(const Result& r) {
+    std::ostringstream out;
+    out << "{\"model\": " << json_str(r.model) << ", \"tasks\": " << r.tasks << ", \"counted\": " << r.counted
+        << ", \"runs\": [";
+    for (size_t i = 0; i < r.runs.size(); i++) out << (i ? ", " : "") << json_num(r.runs[i]);
+    const LatencySet& l = r.latency;
+    out << "], \"connect\": ";
+    write_wire_histogram(out, l.connect);
+    out << ", \"first_byte\": ";
+    write_wire_histogram(out, l.first_byte);
+    out << ", \"total\": ";
+    write_wire_histogram(out, l.total);
+    out << ", \"start_lag\": ";
+    write_wire_histogram(out, l.start_lag);
+    out << ", \"turnaround\": ";
+    write_wire_histogram(out, l.turnaround);
+    const Counters& c = r.counters;
+    out << ", \"late\": " << l.late << ", \"dropped\": " << l.dropped << ", \"yields\": " << l.yields
+        << ", \"sched_ns\": " << l.sched_ns << ", \"capped_depth\": " << l.capped_depth
+        << ", \"counters\": [" << c.cycles << ", "
+        << c.instructions << ", " << c.cache_misses << ", " << c.ctx_switches << ", " << c.voluntary << ", "
+        << c.involuntary << ", " << c.minor_faults << ", " << c.loop_ctl << ", " << c.loop_wait << ", "
+        << json_num(c.user_s) << ", " << json_num(c.sys_s) << "], \"memory\": [" << r.memory.peak_kb << ", "
+        << r.memory.growth_kb << ", " << r.memory.child_kb << ", " << r.memory.inflight << "]}";
+    return out.str();
+}
 
-        while (pending.load(std::memory_order_acquire) > 0) {
-            timespec ts{};
-            ts.tv_sec = 1;
-            ts.tv_nsec = 0;
-
-            int n = ::kevent(kq_, nullptr, 0, evs, MAXEV, &ts);
-            if (n < 0) {
-                if (errno == EINTR) continue;
-                std::perror("kevent wait");
-                std::exit(1);
+static bool result_from_wire(const std::string& text, Result* r) {
+    Json j;
+    if (!JsonParser(text).parse(j) || j.type != Json::Object) return false;
+    const Json* model = j.get("model");
+    const Json* tasks = j.get("tasks");
+    const Json* counted = j.get("counted");
+    const Json* runs = j.get("runs");
+    const Json* counters = j.get("counters");
+    const Json* memory = j.get("memory");
+    const Json* late = j.get("late");
+    const Json* dropped = j.get("dropped");
+    const Json* yields = j.get("yields");
+    const Json* sched_ns = j.get("sched_ns");
+    const Json* capped_depth = j.get("capped_depth");
+    if (!model || !tasks || !counted || !runs || !counters || counters->items.size() != 11 || !memory ||
+        memory->items.size() != 4 || !late || !dropped || !yields || !sched_ns ||
+        !capped_depth) {
+        return false;
+    }
+    r->model = model->str;
+    r->tasks = (int)tasks->num;
+    r->counted = (int)counted->num;
+    for (const auto& v : runs->items) r->runs.push_back(v.num);
+    LatencySet& l = r->latency;
+    if (!read_wire_histogram(j.get("connect"), &l.connect) || !read_wire_histogram(j.get("first_byte"), &l.first_byte) ||
+        !read_wire_histogram(j.get("total"), &l.total) || !read_wire_histogram(j.get("start_lag"), &l.start_lag) ||
+        !read_wire_histogram(j.get("turnaround"), &l.turnaround)) {
+        return false;
+    }
+    l.late = (uint64_t)late->num;
+    l.dropped = (uint64_t)dropped->num;
+    l.yields = (uint64_t)yields->num;
+    l.sched_ns = (uint64_t)sched_ns->num;
+    l.capped_depth = (uint64_t)capped_depth->num;
+    const auto& c = counters->items;
+    int64_t* ints[] = {&r->counters.cycles, &r->counters.instructions, &r->counters.cache_misses,
+                       &r->counters.ctx_switches, &r->counters.voluntary, &r->counters.involuntary,
+                       &r->counters.minor_faults, &r->counters.loop_ctl, &r->counters.loop_wait};
+    for (size_t i = 0; i < 9; i++) *ints[i] = (int64_t)c[i].num;
+    r->counters.user_s = c[9].num;
+    r->counters.sys_s = c[10].num;
+    const auto& m = memory->items;
+    r->memory.peak_kb = (int64_t)m[0].num;
+    r->memory.growth_kb = (int64_t)m[1].num;
+    r->memory.child_kb = (int64_t)m[2].num;
+    r->memory.inflight = std::max(1, (int)m[3].num);
+    return true;
+}
+
+// One row for the whole fleet. The clients started each run together, so
+// run i lasts as long as the slowest client's run i; tasks, histograms and
+// counters add up, and memory is the worst client's (growth: the sum). Each
+// client counted only its own kept runs; counted is their task-weighted mean.
+static Result merge_client_results(const std::vector<Result>& parts) {
+    Result m;
+    m.model = parts[0].model;
+    m.tasks = 0;
+    m.memory = parts[0].memory;
+    m.memory.inflight = 0;
+    size_t nruns = SIZE_MAX;
+    for (const auto& p : parts) nruns = std::min(nruns, p.runs.size());
+    m.runs.assign(nruns, 0.0);
+    double task_runs = 0;
+    for (size_t k = 0; k < parts.size(); k++) {
+        const Result& p = parts[k];
+        for (size_t i = 0; i < nruns; i++) m.runs[i] = std::max(m.runs[i], p.runs[i]);
+        m.latency.merge(p.latency);
+        if (k == 0) m.counters = p.counters;
+        else m.counters.add(p.counters);
+        m.tasks += p.tasks;
+        task_runs += (double)p.counted * p.tasks;
+        m.memory.peak_kb = std::max(m.memory.peak_kb, p.memory.peak_kb);
+        m.memory.child_kb = std::max(m.memory.child_kb, p.memory.child_kb);
+        if (k > 0) m.memory.growth_kb = m.memory.growth_kb < 0 || p.memory.growth_kb < 0 ? -1 : m.memory.growth_kb + p.memory.growth_kb;
+        m.memory.inflight += p.memory.inflight;
+    }
+    m.counted = m.tasks > 0 ? (int)std::lround(task_runs / m.tasks) : 0;
+    return m;
+}
+
+// The client's connection to its coordinator, when --join is given.
+static LineConn* g_join = nullptr;
+
+static void join_lost(const char* step) {
+    std::cerr << "Lost the coordinator at " << step << "\n";
+    std::exit(1);
+}
+
+static void join_barrier(const std::string& suite, const std::string& model) {
+    std::string line;
+    if (!g_join->send_line("READY " + suite + " " + model)) join_lost("READY");
+    if (!g_join->read_line(&line) || line != "GO") join_lost("GO");
+}
+
+static void join_run_barrier() {
+    std::string line;
+    if (!g_join->send_line("RUN")) join_lost("RUN");
+    if (!g_join->read_line(&line) || line != "GO") join_lost("GO");
+}
+
+static void join_report(const Result& r) {
+    if (!g_join->send_line("RESULT " + result_to_wire(r))) join_lost("RESULT");
+}
+
+static int run_server_only(const Config& cfg) {
+    // Blocked before any server thread exists, so every thread inherits the
+    // mask and sigwait() below is the only taker.
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, nullptr);
+
+    EchoServer server;
+    if (!server.start(cfg)) {
+        std::cerr << "Failed to start echo server\n";
+        return 1;
+    }
+    std::cout << "Echo server listening on " << endpoint_str(server.endpoint) << "\n" << std::flush;
+    int sig = 0;
+    sigwait(&stop, &sig);
+    server.stop();
+    return 0;
+}
+
+static int run_coordinator(const Config& cfg, const std::string& command) {
+    Config lcfg = cfg;
+    lcfg.transport = "tcp";
+    Endpoint ep;
+    int lfd = transport_listen(lcfg, &ep, 0, false);
+    if (lfd < 0) {
+        std::cerr << "Failed to listen on " << cfg.bind << "\n";
+        return 1;
+    }
+    std::cout << "Coordinator on " << endpoint_str(ep) << ", waiting for " << cfg.clients << " clients\n" << std::flush;
+
+    std::vector<LineConn> conns((size_t)cfg.clients);
+    std::vector<std::string> names;
+    for (auto& c : conns) {
+        std::string hello;
+        while ((c.fd = ::accept(lfd, nullptr, nullptr)) < 0 && errno == EINTR) {}
+        if (c.fd < 0 || !c.read_line(&hello) || hello.rfind("HELLO ", 0) != 0) {
+            std::cerr << "Bad client handshake\n";
+            return 1;
+        }
+        names.push_back(hello.substr(6));
+        std::cout << "  joined: " << names.back() << "\n" << std::flush;
+    }
+    ::close(lfd);
+    std::cout << "\n";
+
+    std::vector<std::pair<std::string, std::vector<Result>>> suites;
+    while (true) {
+        std::vector<std::string> lines(conns.size());
+        for (size_t i = 0; i < conns.size(); i++) {
+            if (!conns[i].read_line(&lines[i])) {
+                std::cerr << "Client " << names[i] << " went away\n";
+                return 1;
+            }
+        }
+        if (std::all_of(lines.begin(), lines.end(), [](const std::string& l) { return l == "DONE"; })) break;
+        for (size_t i = 0; i < lines.size(); i++) {
+            if (lines[i].rfind("READY ", 0) != 0 || lines[i] != lines[0]) {
+                std::cerr << "Clients disagree on the next row: '" << lines[0] << "' from " << names[0] << ", '"
+                          << lines[i] << "' from " << names[i] << "\n";
+                return 1;
             }
+        }
+        for (auto& c : conns) {
+            if (!c.send_line("GO")) return 1;
+        }
 
-            for (int i = 0; i < n; i++) {
-                void* addr = evs[i].udata;
-                if (!addr) continue;
-                std::coroutine_handle<> h = std::coroutine_handle<>::from_address(addr);
-                if (h) h.resume();
+        std::string row = lines[0].substr(6);
+        std::string suite = row.substr(0, row.find(' '));
+        std::cout << "Running " << suite << ":" << row.substr(row.find(' ') + 1) << " on " << conns.size() << " clients\n"
+                  << std::flush;
+        // Each timed run starts with a RUN from every client and a GO back;
+        // the row ends with every client's RESULT.
+        std::vector<Result> parts(conns.size());
+        while (true) {
+            for (size_t i = 0; i < conns.size(); i++) {
+                if (!conns[i].read_line(&lines[i])) {
+                    std::cerr << "Client " << names[i] << " went away\n";
+                    return 1;
+                }
+            }
+            const size_t runs = (size_t)std::count(lines.begin(), lines.end(), std::string("RUN"));
+            if (runs == conns.size()) {
+                for (auto& c : conns) {
+                    if (!c.send_line("GO")) return 1;
+                }
+                continue;
+            }
+            if (runs > 0) {
+                std::cerr << "Clients disagree on the number of runs in " << row << "; give them the same --repeats\n";
+                return 1;
             }
+            for (size_t i = 0; i < conns.size(); i++) {
+                if (lines[i].rfind("RESULT ", 0) != 0 || !result_from_wire(lines[i].substr(7), &parts[i])) {
+                    std::cerr << "Bad result from " << names[i] << "\n";
+                    return 1;
+                }
+            }
+            break;
         }
+        auto it = std::find_if(suites.begin(), suites.end(), [&](const auto& s) { return s.first == suite; });
+        if (it == suites.end()) it = suites.insert(suites.end(), {suite, {}});
+        it->second.push_back(merge_client_results(parts));
     }
+    for (auto& c : conns) ::close(c.fd);
+    std::cout << "\n";
 
-private:
-    int kq_;
-};
-
-static int set_nonblocking(int fd) {
-    int fl = fcntl(fd, F_GETFL, 0);
-    if (fl < 0) return -1;
-    if (fcntl(fd, F_SETFL, fl | O_NONBLOCK) < 0) return -1;
-    return 0;
+    // The open-loop and streaming tables read --rate and --stream-* from
+    // the coordinator's own command line, scaled to the whole fleet.
+    Config fleet = cfg;
+    fleet.rate *= (int)conns.size();
+    fleet.stream_mb *= (int)conns.size();
+    fleet.stream_conns *= (int)conns.size();
+    for (const auto& [suite, results] : suites) {
+        const std::string clients = " (" + std::to_string(conns.size()) + " clients)";
+        if (suite == "open_loop" && cfg.rate > 0) {
+            print_open_loop_table("Open-loop I/O results" + clients, fleet, results);
+            record_suite(suite, "Open-loop I/O results" + clients, results);
+        } else if (suite == "stream" && cfg.stream_mb > 0) {
+            print_stream_table("Streaming I/O results" + clients, fleet, results);
+            record_suite(suite, "Streaming I/O results" + clients, results);
+        } else {
+            print_md_table("I/O-bound benchmark results" + clients, results);
+            record_suite(suite, "I/O-bound benchmark results" + clients, results);
+        }
+    }
+    return finish_report(cfg, command);
 }
 
-struct FdReadable {
-    KqueueLoop* loop;
-    int fd;
-    bool await_ready() const noexcept { return false; }
-    void await_suspend(std::coroutine_handle<> h) { loop->arm_read(fd, h); }
-    void await_resume() const noexcept {}
+// ---- Model registry ----
+//
+// Every row the benchmark can run, by suite. make() binds a model to a
+// config and the shared resources in env: needs_pool rows get a ThreadPool
+// with --concurrency workers, needs_procs rows the pre-fork pool. --suite
+// and --models pick rows, so a profiling run only pays for what it asked for.
+
+struct ModelEnv {
+    Endpoint ep{};
+    ThreadPool* pool = nullptr;
+    ProcessPool* procs = nullptr;
 };
 
-struct FdWritable {
-    KqueueLoop* loop;
-    int fd;
-    bool await_ready() const noexcept { return false; }
-    void await_suspend(std::coroutine_handle<> h) { loop->arm_write(fd, h); }
-    void await_resume() const noexcept {}
+struct ModelSpec {
+    const char* suite;
+    const char* name;
+    ModelFn (*make)(const Config& cfg, const ModelEnv& env);
+    bool needs_pool = false;
+    bool needs_procs = false;
+    bool (*available)() = nullptr; // nullptr: always
 };
 
-struct IoTask {
-    struct promise_type {
-        KqueueLoop* loop = nullptr;
-        std::atomic<int>* pending = nullptr;
+static const char* const kSuites[] = {"cpu", "io", "open_loop", "stream", "spawn"};
 
-        IoTask get_return_object() { return IoTask{std::coroutine_handle<promise_type>::from_promise(*this)}; }
-        std::suspend_always initial_suspend() noexcept { return {}; }
+static const std::vector<ModelSpec>& model_registry() {
+    using Env = const ModelEnv&;
+    static const std::vector<ModelSpec> specs = {
+        {"cpu", "threads", [](const Config& cfg, Env) -> ModelFn { return [&cfg](LatencySet&) { cpu_threads(cfg); }; }},
+        {"cpu", "pool", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet&) { cpu_pool(cfg, *env.pool); };
+         }, true},
+        {"cpu", "processes", [](const Config& cfg, Env) -> ModelFn { return [&cfg](LatencySet&) { cpu_processes(cfg); }; }},
+        {"cpu", "prefork", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet&) { cpu_prefork(cfg, *env.procs); };
+         }, false, true},
+        {"cpu", "coroutines", [](const Config& cfg, Env) -> ModelFn {
+             return [&cfg](LatencySet& lat) { cpu_coroutines(cfg, lat); };
+         }},
+        {"cpu", "coroutines_mt", [](const Config& cfg, Env) -> ModelFn {
+             return [&cfg](LatencySet&) { cpu_coroutines_mt(cfg); };
+         }},
+        {"cpu", "fibers", [](const Config& cfg, Env) -> ModelFn { return [&cfg](LatencySet&) { cpu_fibers(cfg); }; },
+         false, false, &fibers_available},
 
-        struct Final {
-            bool await_ready() noexcept { return false; }
-            void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
-                if (h.promise().pending) h.promise().pending->fetch_sub(1, std::memory_order_release);
-            }
-            void await_resume() noexcept {}
-        };
+        {"io", "threads", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { io_threads(cfg, env.ep, lat); };
+         }},
+        {"io", "pool", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { io_pool(cfg, *env.pool, env.ep, lat); };
+         }, true},
+        {"io", "processes", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { io_processes(cfg, env.ep, lat); };
+         }},
+        {"io", "prefork", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { io_prefork(cfg, *env.procs, env.ep, lat); };
+         }, false, true},
+        {"io", "coroutines", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { io_coroutines(cfg, env.ep, lat); };
+         }},
+        {"io", "fibers", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { io_fibers(cfg, env.ep, lat); };
+         }, false, false, &fibers_available},
+#if defined(BENCH_HAVE_IO_URING)
+        {"io", "io_uring", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { io_coroutines_uring(cfg, env.ep, lat); };
+         }, false, false, [] { return UringLoop::supported(); }},
+#endif
 
-        Final final_suspend() noexcept { return {}; }
+        {"open_loop", "threads", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { io_threads(cfg, env.ep, lat, true); };
+         }},
+        {"open_loop", "coroutines", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { io_coroutines(cfg, env.ep, lat, true); };
+         }},
 
-        void return_void() noexcept {}
-        void unhandled_exception() { std::terminate(); }
-    };
+        {"stream", "threads", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { stream_threads(cfg, env.ep, lat); };
+         }},
+        {"stream", "coroutines", [](const Config& cfg, Env env) -> ModelFn {
+             return [&cfg, env](LatencySet& lat) { stream_coroutines(cfg, env.ep, lat); };
+         }},
 
-    std::coroutine_handle<promise_type> h;
-    explicit IoTask(std::coroutine_handle<promise_type> h_) : h(h_) {}
-    IoTask(IoTask&& o) noexcept : h(o.h) { o.h = {}; }
-    ~IoTask() { if (h) h.destroy(); }
+        {"spawn", "fork", [](const Config& cfg, Env) -> ModelFn {
+             return [&cfg](LatencySet& lat) { spawn_bench(cfg, SpawnKind::Fork, lat); };
+         }},
+        {"spawn", "vfork", [](const Config& cfg, Env) -> ModelFn {
+             return [&cfg](LatencySet& lat) { spawn_bench(cfg, SpawnKind::Vfork, lat); };
+         }},
+        {"spawn", "fork_exec", [](const Config& cfg, Env) -> ModelFn {
+             return [&cfg](LatencySet& lat) { spawn_bench(cfg, SpawnKind::ForkExec, lat); };
+         }},
+        {"spawn", "posix_spawn", [](const Config& cfg, Env) -> ModelFn {
+             return [&cfg](LatencySet& lat) { spawn_bench(cfg, SpawnKind::PosixSpawn, lat); };
+         }},
+#if defined(__linux__)
+        {"spawn", "clone_vm", [](const Config& cfg, Env) -> ModelFn {
+             return [&cfg](LatencySet& lat) { spawn_bench(cfg, SpawnKind::CloneVm, lat); };
+         }},
+#endif
+    };
+    return specs;
+}
 
-    void start(KqueueLoop* loop, std::atomic<int>* pending) {
-        h.promise().loop = loop;
-        h.promise().pending = pending;
-        h.resume();
+// --models entries are a model name ("coroutines", every suite) or
+// suite:name ("io:coroutines").
+static bool model_selected(const Config& cfg, const ModelSpec& m) {
+    if (!cfg.suites.empty() && std::find(cfg.suites.begin(), cfg.suites.end(), m.suite) == cfg.suites.end()) {
+        return false;
     }
-};
-
-static IoTask io_client_task(KqueueLoop* loop, std::atomic<int>* pending,
-                             uint16_t port, int payload_size) {
-    int s = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (s < 0) co_return;
-    if (set_nonblocking(s) < 0) { ::close(s); co_return; }
+    if (cfg.models.empty()) return true;
+    for (const auto& want : cfg.models) {
+        if (want == m.name || want == std::string(m.suite) + ":" + m.name) return true;
+    }
+    return false;
+}
 
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-    addr.sin_port = htons(port);
+static std::vector<const ModelSpec*> selected_models(const Config& cfg, const std::string& suite) {
+    std::vector<const ModelSpec*> out;
+    for (const auto& m : model_registry()) {
+        if (m.suite == suite && model_selected(cfg, m)) out.push_back(&m);
+    }
+    return out;
+}
 
-    int rc = ::connect(s, (sockaddr*)&addr, sizeof(addr));
-    if (rc < 0) {
-        if (errno != EINPROGRESS) { ::close(s); co_return; }
-        co_await FdWritable{loop, s};
-        int err = 0;
-        socklen_t len = sizeof(err);
-        if (getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
-            ::close(s);
-            co_return;
+// Models and suites that name nothing in the registry are a usage error.
+static bool check_selection(const Config& cfg) {
+    bool ok = true;
+    for (const auto& s : cfg.suites) {
+        if (std::find_if(std::begin(kSuites), std::end(kSuites), [&](const char* k) { return s == k; }) == std::end(kSuites)) {
+            std::cerr << "Unknown suite '" << s << "' (cpu, io, open_loop, stream, spawn)\n";
+            ok = false;
+        }
+    }
+    for (const auto& want : cfg.models) {
+        bool known = false;
+        for (const auto& m : model_registry()) {
+            known |= want == m.name || want == std::string(m.suite) + ":" + m.name;
+        }
+        if (!known) {
+            std::cerr << "Unknown model '" << want << "' (see --list-models)\n";
+            ok = false;
         }
     }
+    return ok;
+}
 
-    std::vector<char> payload((size_t)payload_size, 'x');
+static bool selection_needs(const Config& cfg, bool ModelSpec::*flag) {
+    for (const auto& m : model_registry()) {
+        if (m.*flag && model_selected(cfg, m)) return true;
+    }
+    return false;
+}
 
-    size_t off = 0;
-    while (off < payload.size()) {
-        ssize_t w = ::send(s, payload.data() + off, payload.size() - off, 0);
-        if (w > 0) { off += (size_t)w; continue; }
-        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-            co_await FdWritable{loop, s};
-            continue;
+// False, with a note on stderr, for a model this host can't run. A sweep asks
+// at every point; the note is printed once per model.
+static bool model_available(const ModelSpec* m) {
+    if (!m->available || m->available()) return true;
+    static std::vector<const ModelSpec*> noted;
+    if (std::find(noted.begin(), noted.end(), m) == noted.end()) {
+        noted.push_back(m);
+        std::cerr << m->suite << ":" << m->name << " unavailable, skipping\n";
+    }
+    return false;
+}
+
+// Runs the selected rows of one suite back to back. Pool rows get a
+// ThreadPool of their own for the duration of the row: hundreds of idle
+// threads in the parent make every fork() in the processes rows several
+// times slower.
+static std::vector<Result> run_suite(const Config& cfg, const std::string& suite, ModelEnv env) {
+    std::vector<Result> results;
+    for (const ModelSpec* m : selected_models(cfg, suite)) {
+        if (!model_available(m)) continue;
+        std::unique_ptr<ThreadPool> pool;
+        if (m->needs_pool) {
+            pool = std::make_unique<ThreadPool>(cfg, cfg.concurrency);
+            env.pool = pool.get();
         }
-        ::close(s);
-        co_return;
+        if (g_join) join_barrier(suite, m->name);
+        results.push_back(run_repeated(cfg, m->name, m->make(cfg, env)));
+        // Stream rows count connections, so per-task columns are per connection.
+        if (suite == "stream") results.back().tasks = results.back().memory.inflight = cfg.stream_conns;
+        if (g_join) join_report(results.back());
     }
+    return results;
+}
 
-    std::vector<char> buf(payload.size());
-    size_t got = 0;
-    while (got < buf.size()) {
-        ssize_t n = ::recv(s, buf.data() + got, buf.size() - got, 0);
-        if (n > 0) { got += (size_t)n; continue; }
-        if (n == 0) { ::close(s); co_return; }
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            co_await FdReadable{loop, s};
-            continue;
+// Like run_suite, but round-robin: every round runs each model once,
+// starting one model later than the previous round, so slow drift
+// (thermals, TIME_WAIT build-up) is spread across all models. Pool rows get
+// their ThreadPool built around each of their runs, outside the timed
+// region, so it never exists while another row forks.
+static std::vector<Result> run_interleaved(const Config& cfg, const std::string& suite, const ModelEnv& env,
+                                           int rotate = 0) {
+    std::vector<const ModelSpec*> models;
+    for (const ModelSpec* m : selected_models(cfg, suite)) {
+        if (model_available(m)) models.push_back(m);
+    }
+    auto with_model = [&](const ModelSpec* m, auto&& body) {
+        std::unique_ptr<ThreadPool> pool;
+        ModelEnv e = env;
+        if (m->needs_pool) {
+            pool = std::make_unique<ThreadPool>(cfg, cfg.concurrency);
+            e.pool = pool.get();
         }
-        ::close(s);
-        co_return;
+        ModelFn fn = m->make(cfg, e);
+        body(fn);
+    };
+
+    auto scratch = std::make_unique<LatencySet>();
+    std::vector<Result> results;
+    for (const ModelSpec* m : models) {
+        results.push_back(make_result(cfg, m->name));
+        with_model(m, [&](ModelFn& fn) { results.back().warmups = warm_up(cfg, fn, *scratch); });
+    }
+    // Models that have converged sit out later rounds.
+    const size_t n = models.size();
+    for (int round = 0;; round++) {
+        bool ran = false;
+        for (size_t k = 0; k < n; k++) {
+            size_t i = (k + (size_t)(round + rotate)) % n;
+            if (done_repeating(cfg, results[i])) continue;
+            with_model(models[i], [&](ModelFn& fn) { timed_run(fn, results[i]); });
+            ran = true;
+        }
+        if (!ran) break;
     }
+    for (Result& r : results) count_kept_runs(r);
+    return results;
+}
 
-    ::close(s);
-    co_return;
+// Tasks (CPU) or requests (I/O) per second at the median run.
+static double throughput(const Result& r, const Config& cfg, bool io) {
+    double work = (double)r.tasks * (io ? cfg.requests_per_conn : 1);
+    return work / run_stats(r.runs).median;
 }
 
-static void io_coroutines_kqueue(const Config& cfg, uint16_t port) {
-    KqueueLoop loop;
-    std::atomic<int> pending{0};
+static std::string fmt_rate(double v) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(v < 100 ? 1 : 0) << v;
+    return oss.str();
+}
 
-    int launched = 0;
-    int inflight = 0;
+struct SweepPoint {
+    Config cfg;
+    std::vector<int> values; // one per swept dimension
+    std::vector<Result> results;
+};
+
+// One table with every point, then (when more than one dimension is swept)
+// one table per dimension with the geometric-mean speedup per value.
+static void print_sweep_tables(const std::string& title, const Config& cfg, const std::vector<SweepPoint>& points,
+                               bool io) {
+    if (points.empty() || points[0].results.empty()) return;
+    const auto& models = points[0].results;
+    auto speedup = [&](const SweepPoint& p, size_t m) {
+        for (const auto& b : p.results) {
+            if (b.model == cfg.baseline) return throughput(p.results[m], p.cfg, io) / throughput(b, p.cfg, io);
+        }
+        return -1.0;
+    };
+    auto fmt_x = [](double x) {
+        if (x < 0) return std::string("-");
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(2) << x << "x";
+        return oss.str();
+    };
 
-    std::vector<IoTask> active;
-    active.reserve((size_t)cfg.concurrency);
+    std::cout << "### " << title << " (" << (io ? "req/s" : "tasks/s") << ", speedup vs " << cfg.baseline << ")\n\n";
+    std::cout << "|";
+    for (const auto& d : cfg.sweep) std::cout << " " << d.first << " |";
+    for (const auto& r : models) std::cout << " " << r.model << " |";
+    std::cout << "\n|";
+    for (size_t i = 0; i < cfg.sweep.size() + models.size(); i++) std::cout << "----:|";
+    std::cout << "\n";
+    for (const auto& p : points) {
+        std::cout << "|";
+        for (int v : p.values) std::cout << " " << v << " |";
+        for (size_t m = 0; m < p.results.size(); m++) {
+            std::cout << " " << fmt_rate(throughput(p.results[m], p.cfg, io)) << " (" << fmt_x(speedup(p, m)) << ") |";
+        }
+        std::cout << "\n";
+    }
+    std::cout << "\n";
 
-    auto launch_one = [&]() {
-        pending.fetch_add(1, std::memory_order_release);
-        inflight++;
+    if (cfg.sweep.size() < 2) return;
+    for (size_t d = 0; d < cfg.sweep.size(); d++) {
+        std::cout << "#### By " << cfg.sweep[d].first << " (geomean speedup vs " << cfg.baseline << ")\n\n";
+        std::cout << "| " << cfg.sweep[d].first << " |";
+        for (const auto& r : models) std::cout << " " << r.model << " |";
+        std::cout << "\n|----:|";
+        for (size_t i = 0; i < models.size(); i++) std::cout << "----:|";
+        std::cout << "\n";
+        for (int v : cfg.sweep[d].second) {
+            std::cout << "| " << v << " |";
+            for (size_t m = 0; m < models.size(); m++) {
+                double log_sum = 0;
+                int n = 0;
+                for (const auto& p : points) {
+                    double x = p.values[d] == v ? speedup(p, m) : -1;
+                    if (x <= 0) continue;
+                    log_sum += std::log(x);
+                    n++;
+                }
+                std::cout << " " << fmt_x(n ? std::exp(log_sum / n) : -1) << " |";
+            }
+            std::cout << "\n";
+        }
+        std::cout << "\n";
+    }
+}
 
-        IoTask t = io_client_task(&loop, &pending, port, cfg.payload_size);
-        t.start(&loop, &pending);
-        active.emplace_back(std::move(t));
-        launched++;
-    };
+// --sweep: runs the cartesian product of the swept values in this process,
+// against one echo server that stays warm throughout. Concurrency is the
+// outermost dimension, so the pre-fork pool is only rebuilt when it changes;
+// every other parameter reaches it per batch. Its children are separate
+// processes, so unlike a ThreadPool it doesn't slow the parent's fork().
+// The cpu and io models --models selects run interleaved
+// (run_interleaved), rotated further at every point.
+static void run_param_sweep(const Config& base, const Endpoint& ep) {
+    Config cfg = base;
+    std::stable_partition(cfg.sweep.begin(), cfg.sweep.end(),
+                          [](const auto& d) { return d.first == "concurrency"; });
 
-    while (launched < cfg.tasks && inflight < cfg.concurrency) launch_one();
+    std::vector<SweepPoint> cpu_points;
+    std::vector<SweepPoint> io_points;
+    std::vector<size_t> odo(cfg.sweep.size(), 0);
+    std::unique_ptr<ProcessPool> procs;
+    int pool_size = -1;
+    int rotate = 0;
 
-    int last_pending = pending.load(std::memory_order_acquire);
+    while (true) {
+        SweepPoint pt{cfg, {}, {}};
+        for (size_t d = 0; d < cfg.sweep.size(); d++) {
+            int v = cfg.sweep[d].second[odo[d]];
+            *sweep_field(pt.cfg, cfg.sweep[d].first) = v;
+            pt.values.push_back(v);
+        }
+        const Config& c = pt.cfg;
+        if (c.concurrency != pool_size) {
+            procs.reset();
+            if (selection_needs(c, &ModelSpec::needs_procs)) procs = std::make_unique<ProcessPool>(c, c.concurrency);
+            pool_size = c.concurrency;
+        }
 
-    while (pending.load(std::memory_order_acquire) > 0) {
-        loop.run_until(pending);
+        std::cerr << "sweep point";
+        for (size_t d = 0; d < cfg.sweep.size(); d++) std::cerr << " " << cfg.sweep[d].first << "=" << pt.values[d];
+        std::cerr << "\n";
 
-        int p = pending.load(std::memory_order_acquire);
-        int finished_now = last_pending - p;
-        if (finished_now > 0) {
-            inflight -= finished_now;
-            last_pending = p;
-            while (launched < cfg.tasks && inflight < cfg.concurrency) {
-                launch_one();
-                last_pending = pending.load(std::memory_order_acquire);
-            }
+        ModelEnv env{ep, nullptr, procs.get()};
+        SweepPoint io_pt = pt;
+        pt.results = run_interleaved(c, "cpu", env, rotate);
+        io_pt.results = run_interleaved(c, "io", env, rotate);
+        std::string point;
+        for (size_t d = 0; d < cfg.sweep.size(); d++) {
+            point += (d ? " " : "") + cfg.sweep[d].first + "=" + std::to_string(pt.values[d]);
         }
+        record_suite("sweep_cpu[" + point + "]", "Sweep: CPU-bound, " + point, pt.results);
+        record_suite("sweep_io[" + point + "]", "Sweep: I/O-bound, " + point, io_pt.results);
+        cpu_points.push_back(std::move(pt));
+        io_points.push_back(std::move(io_pt));
+        rotate++;
+
+        size_t d = cfg.sweep.size();
+        while (d > 0 && ++odo[d - 1] == cfg.sweep[d - 1].second.size()) odo[--d] = 0;
+        if (d == 0) break;
     }
+    procs.reset();
+
+    print_sweep_tables("Sweep: CPU-bound", cfg, cpu_points, false);
+    print_sweep_tables("Sweep: I/O-bound", cfg, io_points, true);
+}
+
+static void run_spawn_suite(const Config& cfg, const std::string& key, const std::string& title) {
+    std::vector<Result> results = run_suite(cfg, "spawn", {});
+    print_spawn_table(title, results);
+    record_suite(key, title, results);
 }
 
 int main(int argc, char** argv) {
     Config cfg = parse_args(argc, argv);
+    if (!check_selection(cfg)) return 1;
+    if (cfg.list_models) {
+        for (const auto& m : model_registry()) {
+            bool avail = !m.available || m.available();
+            std::cout << m.suite << ":" << m.name << (avail ? "" : " (unavailable)") << "\n";
+        }
+        return 0;
+    }
+    std::string command;
+    for (int i = 0; i < argc; i++) command += (i ? " " : "") + std::string(argv[i]);
+    if (cfg.coordinator) return run_coordinator(cfg, command);
 
     std::cout << "Config: tasks=" << cfg.tasks
               << ", concurrency=" << cfg.concurrency
-              << ", repeats=" << cfg.repeats << "\n\n";
+              << ", grain=" << cfg.grain
+              << ", repeats=" << cfg.repeats;
+    if (cfg.target_ci > 0) {
+        std::cout << ".." << cfg.max_repeats << " (ci<=" << cfg.target_ci << "%";
+        if (cfg.time_budget_s > 0) std::cout << ", budget " << cfg.time_budget_s << " s";
+        std::cout << ")";
+    }
+    if (cfg.warmup < 0) std::cout << ", warmup=auto";
+    std::cout
+              << ", requests/conn=" << cfg.requests_per_conn
+              << ", pipeline=" << cfg.pipeline_depth
+              << ", loop=" << cfg.loop << " (" << cfg.arm << ")"
+              << ", server=" << cfg.server
+              << ", transport=" << cfg.transport << (cfg.nodelay ? " (nodelay)" : "")
+              << ", echo=" << cfg.echo << "/" << cfg.echo_buf_kb << "KiB";
+    if (cfg.server_cpu_units > 0) std::cout << ", server-cpu-units=" << cfg.server_cpu_units << " (" << cfg.server_compute << ")";
+    std::cout
+              << ", fibers=" << cfg.fiber_switch << "/" << cfg.fiber_stack_kb << "KiB"
+              << ", kernel=" << cfg.kernel;
+    if (cfg.quantum_us > 0) std::cout << ", quantum=" << cfg.quantum_us << "us";
+    if (cfg.kernel == "simd") std::cout << " (" << g_lanes.name << ")";
+    if (!cfg.pin.empty()) {
+        std::cout << ", pin=" << cfg.pin << " (";
+        for (size_t i = 0; i < cfg.client_cpus.size() && i < 16; i++) std::cout << (i ? "," : "") << cfg.client_cpus[i];
+        if (cfg.client_cpus.size() > 16) std::cout << ",...";
+        std::cout << ")";
+    }
+    if (!cfg.server_cpus.empty()) std::cout << ", server-cpus=" << cfg.server_cpus;
+    if (cfg.numa != "none") std::cout << ", numa=" << cfg.numa;
+    std::cout << "\n\n";
+
+    if (cfg.server_only) return run_server_only(cfg);
+
+    // --client: the echo server is remote, and only the suites that talk to
+    // it run.
+    const bool local = !cfg.client;
+    Endpoint target{};
+    if (cfg.client) {
+        if (!resolve_endpoint(cfg.target, false, &target)) {
+            std::cerr << "Cannot resolve --target " << cfg.target << "\n";
+            return 1;
+        }
+        target.nodelay = cfg.nodelay;
+    }
+    LineConn join;
+    if (!cfg.join.empty()) {
+        Endpoint coord;
+        bool pending;
+        char host[256] = {};
+        gethostname(host, sizeof(host) - 1);
+        if (!resolve_endpoint(cfg.join, false, &coord) || (join.fd = transport_connect(coord, false, 0, &pending)) < 0 ||
+            !join.send_line("HELLO " + std::string(host) + "/" + std::to_string((int)::getpid()))) {
+            std::cerr << "Cannot join coordinator " << cfg.join << "\n";
+            return 1;
+        }
+        g_join = &join;
+        g_before_run = join_run_barrier;
+    }
+
+    // The CPU coroutine scheduler converts cycle counts with ticks_per_ns();
+    // its ~5 ms calibration runs here rather than inside the first timed run.
+    if (local && !selected_models(cfg, "cpu").empty()) (void)ticks_per_ns();
+
+    if (!cfg.sweep.empty()) {
+        EchoServer server;
+        if (!server.start(cfg)) {
+            std::cerr << "Failed to start echo server\n";
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        run_param_sweep(cfg, server.endpoint);
+        server.stop();
+        return finish_report(cfg, command);
+    }
 
-    std::cout << "CPU-bound benchmark (pure compute loop)\n\n";
-    std::vector<Result> cpu_results;
-    cpu_results.push_back(run_repeated(cfg, "threads", [&]{ cpu_threads(cfg); }));
-    cpu_results.push_back(run_repeated(cfg, "processes", [&]{ cpu_processes(cfg); }));
-    cpu_results.push_back(run_repeated(cfg, "coroutines", [&]{ cpu_coroutines(cfg); }));
-    print_md_table("CPU-bound benchmark results", cpu_results);
+    // Fork the process pool before any other thread exists; run_suite
+    // scopes thread pools to their rows.
+    std::unique_ptr<ProcessPool> procs;
+    if (selection_needs(cfg, &ModelSpec::needs_procs)) procs = std::make_unique<ProcessPool>(cfg, cfg.concurrency);
+
+    if (local && !selected_models(cfg, "cpu").empty()) {
+        std::cout << "CPU-bound benchmark (pure compute loop)\n\n";
+        std::vector<Result> cpu_results = run_suite(cfg, "cpu", {Endpoint{}, nullptr, procs.get()});
+        print_md_table("CPU-bound benchmark results", cpu_results);
+        print_sched_table(cfg, cpu_results);
+        record_suite("cpu", "CPU-bound benchmark results", cpu_results);
+    }
 
+    bool need_server = local && (!selected_models(cfg, "io").empty() || cfg.mem_budget_mb > 0 ||
+                                 (cfg.rate > 0 && !selected_models(cfg, "open_loop").empty()) ||
+                                 (cfg.stream_mb > 0 && !selected_models(cfg, "stream").empty()));
     EchoServer server;
-    if (!server.start(cfg.backlog)) {
-        std::cerr << "Failed to start echo server\n";
-        return 1;
+    if (need_server) {
+        if (!server.start(cfg)) {
+            std::cerr << "Failed to start echo server\n";
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ModelEnv env{local ? server.endpoint : target, nullptr, procs.get()};
 
-    std::cout << "I/O-bound benchmark (local TCP echo)\n\n";
-    std::vector<Result> io_results;
-    io_results.push_back(run_repeated(cfg, "threads", [&]{ io_threads(cfg, server.port); }));
-    io_results.push_back(run_repeated(cfg, "processes", [&]{ io_processes(cfg, server.port); }));
-    io_results.push_back(run_repeated(cfg, "coroutines", [&]{ io_coroutines_kqueue(cfg, server.port); }));
+    if (!selected_models(cfg, "io").empty()) {
+        std::cout << "I/O-bound benchmark (" << (local ? "local echo server" : "echo server at " + cfg.target) << ")\n\n";
+        std::vector<Result> io_results = run_suite(cfg, "io", env);
+        print_md_table("I/O-bound benchmark results", io_results);
+        record_suite("io", "I/O-bound benchmark results", io_results);
+    }
 
-    print_md_table("I/O-bound benchmark results", io_results);
+    if (cfg.rate > 0 && !selected_models(cfg, "open_loop").empty()) {
+        std::cout << "Open-loop I/O (" << cfg.rate << " tasks/s, " << cfg.arrival << " arrivals)\n\n";
+        std::vector<Result> open_results = run_suite(cfg, "open_loop", env);
+        print_open_loop_table("Open-loop I/O results", cfg, open_results);
+        record_suite("open_loop", "Open-loop I/O results", open_results);
+    }
 
-    server.stop();
+    if (cfg.stream_mb > 0 && !selected_models(cfg, "stream").empty()) {
+        std::cout << "Streaming I/O (" << cfg.stream_mb << " MiB per run over " << cfg.stream_conns << " connections, "
+                  << cfg.stream_chunk_kb << " KiB chunks, echo=" << cfg.echo << ")\n\n";
+        std::vector<Result> stream_results = run_suite(cfg, "stream", env);
+        print_stream_table("Streaming I/O results", cfg, stream_results);
+        record_suite("stream", "Streaming I/O results", stream_results);
+    }
 
-    return 0;
+    if (g_join && !join.send_line("DONE")) join_lost("DONE");
+    if (!local) return finish_report(cfg, command);
+
+    if (cfg.mem_budget_mb > 0) {
+        std::cout << "Memory sweep (" << cfg.mem_budget_mb << " MiB budget, up to " << cfg.sweep_max << " tasks)\n\n";
+        run_memory_sweep(cfg, server.endpoint);
+    }
+
+    if (need_server) server.stop();
+
+    if (cfg.timers > 0) {
+        std::cout << "Timer wheel benchmark (" << cfg.timers << " timers over " << cfg.timer_span_ms << " ms, " << cfg.loop << ")\n\n";
+        run_timer_bench(cfg);
+    }
+
+    if (selected_models(cfg, "spawn").empty()) return finish_report(cfg, command);
+    std::cout << "Process spawn benchmark (" << cfg.spawn_tasks << " children per run)\n\n";
+    run_spawn_suite(cfg, "spawn", "Process spawn results (small parent)");
+    if (cfg.spawn_heap_mb > 0) {
+        // Pre-touch every page so the parent's resident set really is this big.
+        std::vector<char> heap((size_t)cfg.spawn_heap_mb << 20);
+        std::memset(heap.data(), 1, heap.size());
+        run_spawn_suite(cfg, "spawn_heap", "Process spawn results (" + std::to_string(cfg.spawn_heap_mb) + " MiB parent heap)");
+    }
+
+    return finish_report(cfg, command);
 }